@@ -9,9 +9,14 @@
 
 
 #include "random_number.h"
+#include "random_counter.h"
+#include "random_quality.h"
+#include "random_seeds.h"
 #include "random_walk.h"
+#include "random_walk_lanes.h"
 #include "output.h"
 #include <random> // for comparison with C++ PRNG
+#include <chrono> // for timing the engines
 
 void comparePRNG(int count, uint64_t myseed = std::time(nullptr)){
 	// compare distribution of uniform-distributed random number generated by custom algorithm and C++ standard algorithm
@@ -48,9 +53,241 @@ void comparePRNG(int count, uint64_t myseed = std::time(nullptr)){
 	std::cout << "\n";
 }
 
+void compareGaussian(int count, uint64_t myseed = std::time(nullptr)){
+	// compare distribution of Gaussian-distributed random number generated by Box-Muller transform and ziggurat method
+	RandomNumber bm(myseed, 0); // Weyl mode, so that no seed collapses
+	RandomNumber zig(myseed, 0);
+	zig.setGauMethod(ZIGGURAT);
+	int bmDis[12] = {0}; // bins of width 0.5 from -3 to 3
+	int zigDis[12] = {0};
+	double bmSum[2] = {0}, zigSum[2] = {0}; // sum and sum of squares
+
+	for (int i = 0; i < count / 2; i++){
+		std::pair<double, double> rb = bm.ranGau();
+		std::pair<double, double> rz = zig.ranGau();
+		double vb[2] = {rb.first, rb.second};
+		double vz[2] = {rz.first, rz.second};
+		for (int j = 0; j < 2; j++){
+			if (std::abs(vb[j]) < 3)
+				bmDis[static_cast<int>((vb[j] + 3) * 2)]++;
+			if (std::abs(vz[j]) < 3)
+				zigDis[static_cast<int>((vz[j] + 3) * 2)]++;
+			bmSum[0] += vb[j]; bmSum[1] += vb[j] * vb[j];
+			zigSum[0] += vz[j]; zigSum[1] += vz[j] * vz[j];
+		}
+	}
+	int n = count / 2 * 2;
+	std::cout << "Gaussian distribution from -3.0 to 2.5\n";
+	for (int i = 0; i < 12; i++)
+		std::cout << -3 + i * 0.5 << "\t";
+	std::cout << "\nBox-Muller (mean " << bmSum[0] / n << ", variance " << bmSum[1] / n - (bmSum[0] / n) * (bmSum[0] / n) << ")" << std::endl;
+	for (int i = 0; i < 12; i++)
+		std::cout << bmDis[i] << "\t";
+	std::cout << "\nZiggurat (mean " << zigSum[0] / n << ", variance " << zigSum[1] / n - (zigSum[0] / n) * (zigSum[0] / n) << ")" << std::endl;
+	for (int i = 0; i < 12; i++)
+		std::cout << zigDis[i] << "\t";
+	std::cout << "\n";
+}
+
+template<class Engine>
+void benchmarkEngine(const char* name, Engine gen, int count){
+	// time the free ranUni(), ranGau() and ranBin() on one engine, so every engine runs the same inlined code
+	double sum = 0; // printed, so that the loops are not optimized away
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+	for (int i = 0; i < count; i++)
+		sum += ranUni(gen);
+	std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+	for (int i = 0; i < count / 2; i++){
+		std::pair<double, double> rg = ranGau(gen);
+		sum += rg.first + rg.second;
+	}
+	std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+	for (int i = 0; i < count; i++)
+		sum += ranBin(gen);
+	std::chrono::steady_clock::time_point t3 = std::chrono::steady_clock::now();
+
+	std::cout << std::setw(20) << std::left << name << std::right << std::fixed << std::setprecision(2);
+	std::cout << std::setw(10) << std::chrono::duration<double, std::nano>(t1 - t0).count() / count;
+	std::cout << std::setw(10) << std::chrono::duration<double, std::nano>(t2 - t1).count() / count;
+	std::cout << std::setw(10) << std::chrono::duration<double, std::nano>(t3 - t2).count() / count;
+	std::cout << "\t(checksum " << sum << ")" << std::endl;
+	std::cout.unsetf(std::ios::fixed);
+}
+
+void compareEngines(int count, uint64_t myseed = std::time(nullptr)){
+	// nanoseconds per number for each engine
+	std::cout << std::setw(20) << std::left << "Engine" << std::right << std::setw(10) << "ranUni" << std::setw(10) << "ranGau" << std::setw(10) << "ranBin" << std::endl;
+	benchmarkEngine("middle-square", MiddleSquareEngine(myseed), count);
+	benchmarkEngine("middle-square Weyl", MiddleSquareEngine(myseed, 0), count);
+	benchmarkEngine("Squares counter", CounterRandomNumber(myseed), count);
+	benchmarkEngine("std::mt19937", std::mt19937(myseed), count);
+	benchmarkEngine("std::mt19937_64", std::mt19937_64(myseed), count);
+}
+
+void compareUniModes(int count, uint64_t myseed = std::time(nullptr)){
+	// nanoseconds per number for each conversion of raw bits to a uniform-distributed number
+	const char* names[] = {"legacy", "[0, 1) 53 bits", "(0, 1) 52 bits", "[0, 1] 53 bits"};
+	const UniMode modes[] = {UNI_LEGACY, UNI_CLOSED_OPEN, UNI_OPEN, UNI_CLOSED};
+	const int BLOCK = 4096;
+	std::vector<double> buf(BLOCK);
+	double sum = 0; // printed, so that the loops are not optimized away
+	std::cout << std::setw(20) << std::left << "Conversion" << std::right << std::setw(10) << "ranUni" << std::setw(10) << "fillUni" << std::endl;
+	for (int m = 0; m < 4; m++){
+		RandomNumber rn(myseed, 0);
+		rn.setUniMode(modes[m]);
+		std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+		for (int i = 0; i < count; i++)
+			sum += rn.ranUni();
+		std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+		for (int i = 0; i < count; i += BLOCK){
+			rn.fillUni(buf.data(), BLOCK);
+			sum += buf[BLOCK - 1];
+		}
+		std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+		std::cout << std::setw(20) << std::left << names[m] << std::right << std::fixed << std::setprecision(2);
+		std::cout << std::setw(10) << std::chrono::duration<double, std::nano>(t1 - t0).count() / count;
+		std::cout << std::setw(10) << std::chrono::duration<double, std::nano>(t2 - t1).count() / count << std::endl;
+		std::cout.unsetf(std::ios::fixed);
+	}
+	RandomNumber rn(myseed, 0);
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+	for (int i = 0; i < count; i++)
+		sum += rn.ranUniF();
+	std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+	std::cout << std::setw(20) << std::left << "float [0, 1) 24 bits" << std::right << std::fixed << std::setprecision(2);
+	std::cout << std::setw(10) << std::chrono::duration<double, std::nano>(t1 - t0).count() / count << std::endl;
+	std::cout.unsetf(std::ios::fixed);
+	std::cout << "(checksum " << sum << ")" << std::endl;
+}
+
+void checkQuality(uint64_t samples, uint64_t myseed = std::time(nullptr)){
+	// statistical battery on every core; shard k of the original mode gets its own seed, shard k of the Weyl mode is substream k
+	unsigned threads = std::max(std::thread::hardware_concurrency(), 1u);
+	std::cout << "Original mode" << std::endl;
+	printQualityResults(qualityBattery(samples, threads, [myseed](size_t k){return RandomNumber(mix64(myseed + k));}));
+	std::cout << "Weyl mode" << std::endl;
+	printQualityResults(qualityBattery(samples, threads, [myseed](size_t k){return RandomNumber(myseed, 0).stream(k);}));
+}
+
+void checkBinomial(int n, double p, uint64_t samples, uint64_t myseed = std::time(nullptr)){
+	// compare ranBinom(n, p) with the exact pmf: chi-square over bins of at least 20 expected values, and the
+	// z-score of the mass farther than 20 from the mode, where BTPE decides by its Stirling-formula test
+	RandomNumber rn(myseed, 0);
+	BinomialParams bp(n, p);
+	std::vector<uint64_t> count(n + 1);
+	for (uint64_t i = 0; i < samples; i++)
+		count[rn.ranBinom(bp)]++;
+	int mode = static_cast<int>(std::floor((n + 1) * p));
+	double chi2 = 0, expected = 0, tailExpected = 0;
+	uint64_t observed = 0, tailObserved = 0;
+	int bins = 0;
+	for (int k = 0; k <= n; k++){
+		double e = samples * std::exp(std::lgamma(n + 1.0) - std::lgamma(k + 1.0) - std::lgamma(n - k + 1.0) + k * std::log(p) + (n - k) * std::log1p(-p));
+		expected += e;
+		observed += count[k];
+		if (expected >= 20 || k == n){
+			chi2 += (observed - expected) * (observed - expected) / expected;
+			bins++;
+			expected = 0;
+			observed = 0;
+		}
+		if (std::abs(k - mode) > 20){
+			tailExpected += e;
+			tailObserved += count[k];
+		}
+	}
+	double z = (tailObserved - tailExpected) / std::sqrt(tailExpected);
+	std::cout << "Binomial(" << n << ", " << p << "), " << samples << " samples" << std::endl;
+	std::cout << "chi-square " << chi2 << " on " << bins - 1 << " degrees of freedom, p = " << chiSquareP(chi2, bins - 1) << std::endl;
+	std::cout << "beyond mode +- 20: z = " << z << ", p = " << normalP(z) << std::endl;
+}
+
+void checkSeeds(uint64_t first, uint64_t count, uint64_t limit = 1 << 16){
+	// mark the seeds of [first, first + count) whose original-mode sequence cycles within limit steps, and save the table
+	SeedTable table = scanSeeds(first, count, limit);
+	std::cout << table.badCount() << " of " << count << " seeds cycle within " << limit << " steps" << std::endl;
+	for (uint64_t s = first, shown = 0; s - first < count && shown < 10; s++){
+		if (table.isBad(s)){
+			CycleInfo c = findCycle(s, limit);
+			std::cout << "seed " << s << ": tail " << c.tail << ", period " << c.period << std::endl;
+			shown++;
+		}
+	}
+	table.save("seeds.bin");
+}
+
+struct HalfStep : UniformStep{ // a user policy derived from UniformStep: distances uniform on [0, 0.5)
+	template<class Gen>
+	double operator()(Gen& rn) {return 0.5 * rn.ranUni();}
+
+	double cdf(double t) const {return std::min(2 * t, 1.0);}
+
+	template<class Gen>
+	double truncated(Gen& rn, double reach) {return rn.ranUni() * std::min(reach, 0.5);}
+};
+
+void checkLanes(size_t count, int steps, uint64_t myseed = std::time(nullptr)){
+	// RandomWalkLanes::walk() must give what walk() gives, also for a step policy that only derives from UniformStep,
+	// which the SIMD kernels cannot draw and must leave to walk()
+	std::vector<BasicRandomWalk<double, HalfStep> > lanes, plain;
+	for (size_t i = 0; i < count; i++)
+		lanes.push_back(BasicRandomWalk<double, HalfStep>(HalfStep(), RandomNumber(myseed, 0).stream(i)));
+	plain = lanes;
+	std::vector<int> points(count);
+	std::vector<double> endX(count), endY(count);
+	RandomWalkLanes::walk(lanes.data(), count, steps, nullptr, points.data(), endX.data(), endY.data());
+	size_t differ = 0;
+	for (size_t i = 0; i < count; i++){
+		std::vector<std::vector<double> > p = plain[i].walk(steps);
+		if (points[i] != static_cast<int>(p[0].size()) || endX[i] != p[0].back() || endY[i] != p[1].back() || lanes[i].walk(1) != plain[i].walk(1)) // the last walk compares the generators
+			differ++;
+	}
+	std::cout << "RandomWalkLanes (" << RandomWalkLanes::isa() << "), HalfStep: " << differ << " of " << count << " walkers differ from walk()" << std::endl;
+}
+
+template<class Boundary>
+void checkFlatMap(const char* name, size_t count, int steps, uint64_t myseed){
+	// walkers on a 0 x 2 map must keep x == 0, in walk() and in RandomWalkLanes::walk() alike
+	std::vector<BasicRandomWalk<double, DynamicStep, Boundary> > lanes, plain;
+	for (size_t i = 0; i < count; i++){
+		lanes.push_back(BasicRandomWalk<double, DynamicStep, Boundary>(0, RandomNumber(myseed, 0).stream(i)));
+		lanes.back().setDim(0, 2);
+	}
+	plain = lanes;
+	std::vector<int> points(count);
+	std::vector<double> endX(count), endY(count);
+	RandomWalkLanes::walk(lanes.data(), count, steps, nullptr, points.data(), endX.data(), endY.data());
+	size_t off = 0, differ = 0;
+	for (size_t i = 0; i < count; i++){
+		std::vector<std::vector<double> > p = plain[i].walk(steps);
+		for (size_t j = 0; j < p[0].size(); j++)
+			if (p[0][j] != 0 || std::abs(p[1][j]) > 1){
+				off++;
+				break;
+			}
+		if (points[i] != static_cast<int>(p[0].size()) || endX[i] != p[0].back() || endY[i] != p[1].back())
+			differ++;
+	}
+	std::cout << name << " on 0 x 2: " << off << " of " << count << " walks leave the map, " << differ << " differ in RandomWalkLanes" << std::endl;
+}
+
+void checkFlatMaps(size_t count, int steps, uint64_t myseed = std::time(nullptr)){
+	checkFlatMap<ReflectBoundary>("reflecting", count, steps, myseed);
+	checkFlatMap<PeriodicBoundary>("periodic", count, steps, myseed);
+	checkFlatMap<AbsorbBoundary>("absorbing", count, steps, myseed);
+}
+
 
 int main() {
 //	comparePRNG(10000);
+//	compareGaussian(1000000);
+//	compareEngines(10000000);
+//	compareUniModes(10000000);
+//	checkQuality(100000000);
+//	checkBinomial(400, 0.5, 300000000); // BTPE range; an error of 1e-3 in its acceptance test shows as z > 4
+//	checkSeeds(std::time(nullptr) - 1000000, 2000000);
+//	checkLanes(64, 10000);
+//	checkFlatMaps(64, 10000);
 	outputRanUni(20); // output 20 uniform-distributed random numbers
 	std::cout << "\n";
 	outputRanGau(20); // output 20 Gaussian-distributed random numbers
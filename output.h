@@ -10,9 +10,12 @@
 
 #include <iostream>
 #include <iomanip>   // std::setw
+#include <algorithm> // std::min
 #include <string>
 #include <vector>
 #include "random_number.h"
+#include "random_distributions.h"
+#include "random_walk.h"
 #include "matplotlibcpp.h"
 
 namespace plt = matplotlibcpp;
@@ -24,13 +27,28 @@ void outputRanUni(int count, uint64_t myseed = std::time(nullptr)){
 		std::cout << rn.ranUni() << std::endl;
 }
 
-void outputRanGau(int count, uint64_t myseed = std::time(nullptr)){
+void outputRanGau(int count, uint64_t myseed = std::time(nullptr), bool batch = false){ // count values, two per line; an odd count ends with a single one
 	RandomNumber rn(myseed);
+	GaussianDist gd;
 	std::cout << "Gaussian-distributed Random Numbers\n\ty1\t\ty2" << std::endl;
-	for (int i = 0; i < count / 2; i++){ // each iteration output two random Gaussian values
-		std::pair<double, double> rg = rn.ranGau();
-		std::cout << std::setw(10) << rg.first << "\t";
-		std::cout << std::setw(10) << rg.second << std::endl;
+	if (batch){ // generate the values in blocks with fillGau(), same values up to a few ulp
+		const int BLOCK = 4096;
+		std::vector<double> rg(BLOCK);
+		for (int i = 0; i < count; i += BLOCK){
+			int n = std::min(BLOCK, count - i);
+			gd.generate(rn, rg.data(), n);
+			for (int j = 0; j < n; j++)
+				std::cout << std::setw(10) << rg[j] << (j % 2 || i + j == count - 1 ? "\n" : "\t");
+		}
+		std::cout << std::flush;
+		return;
+	}
+	for (int i = 0; i < count; i++){
+		std::cout << std::setw(10) << gd(rn);
+		if (i % 2 || i == count - 1)
+			std::cout << std::endl;
+		else
+			std::cout << "\t";
 	}
 }
 
@@ -46,7 +64,17 @@ void outputRanBin(int count, uint64_t myseed = std::time(nullptr)){
 	}
 }
 
-void outputRandomWalk(std::vector<std::vector<double> > &coord){
+void outputRanBin(int count, int n, double p, uint64_t myseed = std::time(nullptr)){ // Binomial(n, p) mode
+	RandomNumber rn(myseed);
+	std::vector<int> bin(count);
+	rn.fillBinom(bin.data(), count, n, p);
+	std::cout << "Binomial(" << n << ", " << p << ")-distributed Random Numbers\nx" << std::endl;
+	for (int i = 0; i < count; i++)
+		std::cout << bin[i] << std::endl;
+}
+
+template<class Real>
+void outputRandomWalk(std::vector<std::vector<Real> > &coord){ // Real is double for RandomWalk, float for RandomWalkF
 	std::cout << "x\ty" << std::endl;
 	std::cout << std::fixed;
 	std::cout << std::setprecision(3);
@@ -55,7 +83,19 @@ void outputRandomWalk(std::vector<std::vector<double> > &coord){
 	}
 }
 
-void plotRandomWalk(std::vector<std::vector<double> > coord, RandomWalk &rw, int disMode){
+template<class Real, class Step, class Boundary>
+void outputRandomWalk(BasicRandomWalk<Real, Step, Boundary> &rw, int steps){ // output the positions of rw.lazyWalk(steps) as they are taken, in constant memory
+	std::cout << "x\ty" << std::endl;
+	std::cout << std::fixed;
+	std::cout << std::setprecision(3);
+	for (const std::pair<Real, Real>& p : rw.lazyWalk(steps)){
+		std::cout << p.first << "\t" << p.second << "\n";
+	}
+	std::cout.flush();
+}
+
+template<class Real, class Step, class Boundary>
+void plotRandomWalk(std::vector<std::vector<Real> > coord, BasicRandomWalk<Real, Step, Boundary> &rw, int disMode){
 	std::pair<double, double> xrange = rw.getXRange();
 	std::pair<double, double> yrange = rw.getYRange();
 	std::pair<double, double> des = rw.getDes();
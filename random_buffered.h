@@ -0,0 +1,164 @@
+/*
+ * random_buffered.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: fanchen
+ */
+
+#ifndef RANDOM_BUFFERED_H_
+#define RANDOM_BUFFERED_H_
+
+#include <cstddef> // size_t
+#include <cstdint> // uint64_t
+#include <ctime> // std::time() for seeding purpose
+#include <utility> // std::pair<>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include "random_number.h"
+
+/* Generator front-end whose numbers are made ahead of demand by a producer thread.
+ * The producer fills a fixed-size single-producer/single-consumer ring; one consumer
+ * thread reads it with ranUni(), ranGau() and nextU64(), which cost a few loads as long as
+ * the ring is not empty. Memory is bounded by the capacity given at construction, and the
+ * producer waits while the ring is full (backpressure), so it never runs further ahead.
+ * Every slot holds one raw draw and its uniform; ranGau() applies Box-Muller to the uniforms
+ * of two consecutive slots on the consumer side, so the producer spends a few ns per slot
+ * and the Gaussian transform is paid only by the draws that are used for it. Any mix of
+ * calls returns exactly what RandomNumber(seed) returns for the same calls (legacy ranUni(),
+ * BOX_MULLER ranGau()).
+ * Built from a RandomNumber, it continues that generator's raw sequence with its
+ * setUniMode() and setGauMethod() choices. The uniforms of the slots are made for UNI_LEGACY
+ * and BOX_MULLER; with other settings the consumer converts the raw draws of the ring itself,
+ * with the generator's own code, so the numbers are still exactly those of the generator.
+ * Bits ranBits() had buffered are not carried over, since this front-end has no ranBits().
+ * Compile with -pthread.
+ */
+class BufferedRandomNumber;
+
+struct BufferedRingEngine{ // the raw draws of a BufferedRandomNumber's ring as an engine, for the conversions the slots do not hold
+	typedef uint64_t result_type;
+	static constexpr result_type min() {return 0;}
+	static constexpr result_type max() {return ~static_cast<result_type>(0);}
+
+	BufferedRandomNumber* owner;
+	explicit BufferedRingEngine(BufferedRandomNumber* b) : owner(b){}
+	result_type operator()();
+};
+
+template<>
+inline uint64_t topBits<BufferedRingEngine>(uint64_t x) {return topBits<MiddleSquareEngine>(x);} // the ring holds middle-square draws
+
+class BufferedRandomNumber{
+private:
+	struct Slot{
+		uint64_t raw; // raw bits of the draw
+		double uni; // toUni(raw), if precomputed
+	};
+
+	std::vector<Slot> ring;
+	size_t mask; // ring.size() - 1, the size is a power of two
+	RandomNumber rn; // owned by the producer thread
+	BasicRandomNumber<BufferedRingEngine> conv; // the wrapped generator's settings over the ring, used by the consumer
+	bool precomputed; // UNI_LEGACY and BOX_MULLER: ranUni() and ranGau() read the uniforms of the slots
+
+	// Read and write positions count slots since construction and are reduced with mask.
+	// Each lives in its own cache line, next to the other side's cached copy of it.
+	alignas(64) std::atomic<size_t> head; // next slot the producer writes
+	size_t cachedTail; // producer's copy of tail
+	alignas(64) std::atomic<size_t> tail; // next slot the consumer reads
+	size_t cachedHead; // consumer's copy of head
+	alignas(64) std::atomic<bool> stop;
+	std::thread producer;
+
+	void produce(){
+		const size_t BATCH = 64; // slots published per release store
+		size_t h = head.load(std::memory_order_relaxed);
+		while (!stop.load(std::memory_order_relaxed)){
+			if (h - cachedTail + BATCH > ring.size()){ // full: wait for the consumer
+				cachedTail = tail.load(std::memory_order_acquire);
+				if (h - cachedTail + BATCH > ring.size())
+					std::this_thread::yield();
+				continue;
+			}
+			for (size_t i = 0; i < BATCH; i++){
+				Slot& s = ring[h & mask];
+				s.raw = rn.nextU64();
+				if (precomputed)
+					s.uni = toUni(s.raw);
+				h++;
+			}
+			head.store(h, std::memory_order_release);
+		}
+	}
+
+	size_t take(size_t n){ // position of the next slot, once n slots are ready; the caller then advances tail by n
+		size_t t = tail.load(std::memory_order_relaxed);
+		while (cachedHead - t < n){ // empty: wait for the producer
+			cachedHead = head.load(std::memory_order_acquire);
+			if (cachedHead - t < n)
+				std::this_thread::yield();
+		}
+		return t;
+	}
+
+	void release(size_t n) {tail.store(tail.load(std::memory_order_relaxed) + n, std::memory_order_release);}
+
+	static size_t ringSize(size_t capacity){ // smallest power of two holding capacity slots, at least 128
+		size_t size = 128;
+		while (size < capacity)
+			size *= 2;
+		return size;
+	}
+
+	void start() {producer = std::thread(&BufferedRandomNumber::produce, this);}
+
+public:
+	explicit BufferedRandomNumber(uint64_t seed = std::time(nullptr), size_t capacity = 4096) :
+		ring(ringSize(capacity)), mask(ring.size() - 1), rn(seed), conv(BufferedRingEngine(this)), precomputed(true),
+		head(0), cachedTail(0), tail(0), cachedHead(0), stop(false){start();} // constructor, same numbers as RandomNumber(seed)
+
+	explicit BufferedRandomNumber(const RandomNumber& gen, size_t capacity = 4096) :
+		ring(ringSize(capacity)), mask(ring.size() - 1), rn(gen), conv(BufferedRingEngine(this)),
+		precomputed(gen.getUniMode() == UNI_LEGACY && gen.getGauMethod() == BOX_MULLER),
+		head(0), cachedTail(0), tail(0), cachedHead(0), stop(false){ // constructor, continue gen: its raw sequence, uniform conversion and Gaussian method
+		conv.setUniMode(gen.getUniMode());
+		conv.setGauMethod(gen.getGauMethod());
+		start();
+	}
+
+	~BufferedRandomNumber(){
+		stop.store(true, std::memory_order_relaxed);
+		producer.join();
+	}
+
+	BufferedRandomNumber(const BufferedRandomNumber&) = delete;
+	BufferedRandomNumber& operator=(const BufferedRandomNumber&) = delete;
+
+	size_t capacity() const {return ring.size();}
+
+	uint64_t nextU64() {uint64_t x = ring[take(1) & mask].raw; release(1); return x;} // return the next 64 raw bits
+
+	double ranUni(){ // return the next uniform-distributed random number, as RandomNumber::ranUni()
+		if (!precomputed)
+			return conv.ranUni();
+		double u = ring[take(1) & mask].uni;
+		release(1);
+		return u;
+	}
+
+	std::pair<double, double> ranGau(){ // return the next pair of Gaussian-distributed random numbers, as RandomNumber::ranGau()
+		if (!precomputed)
+			return conv.ranGau();
+		size_t t = take(2);
+		std::pair<double, double> g = boxMuller(ring[t & mask].uni, ring[(t + 1) & mask].uni);
+		release(2);
+		return g;
+	}
+};
+
+inline BufferedRingEngine::result_type BufferedRingEngine::operator()() {return owner->nextU64();}
+
+
+
+#endif /* RANDOM_BUFFERED_H_ */
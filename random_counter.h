@@ -0,0 +1,80 @@
+/*
+ * random_counter.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: fanchen
+ */
+
+#ifndef RANDOM_COUNTER_H_
+#define RANDOM_COUNTER_H_
+
+#include <cstddef> // size_t
+#include <cstdint> // uint64_t
+#include <ctime> // std::time() for seeding purpose
+#include <utility> // std::pair<>
+#include "random_number.h"
+
+/* Counter-based generator: the i-th number of a seed is a keyed function of (seed, i)
+ * alone, so any sample can be reached in O(1) without generating the ones before it.
+ * The function is the "Squares" counter-based RNG (B. Widynski, https://arxiv.org/abs/2004.06278),
+ * i.e. four rounds of the same square-and-swap used by RandomNumber, applied to the
+ * Weyl value ctr * key. The key is derived from the seed and made odd.
+ * Uniform, Gaussian and binomial numbers are built from the raw values exactly like in
+ * RandomNumber, so at(i) is the number ranUni() returns after discard(i) from the start.
+ * It is also a 64-bit uniform random bit generator, so BasicRandomNumber<CounterRandomNumber>
+ * gives the full RandomNumber interface on top of it.
+ */
+class CounterRandomNumber{
+private:
+	uint64_t key;
+	uint64_t ctr; // index of the next number to generate
+public:
+	// std::uniform_random_bit_generator interface, so that BasicRandomNumber and the free functions can run on it
+	typedef uint64_t result_type;
+	static constexpr result_type min() {return 0;}
+	static constexpr result_type max() {return ~static_cast<result_type>(0);}
+	result_type operator()() {return nextU64();}
+
+	CounterRandomNumber(uint64_t seed = std::time(nullptr)) :
+		key(mix64(seed) | 1), ctr(0){} // constructor, default seed is current time
+
+	static uint64_t squares(uint64_t c, uint64_t k){ // raw 64-bit number at counter c for key k
+		uint64_t x, y, z, t;
+		y = x = c * k;
+		z = y + k;
+		x = x * x + y; x = (x >> 32) | (x << 32); // round 1
+		x = x * x + z; x = (x >> 32) | (x << 32); // round 2
+		x = x * x + y; x = (x >> 32) | (x << 32); // round 3
+		t = x = x * x + z; x = (x >> 32) | (x << 32); // round 4
+		return t ^ ((x * x + y) >> 32); // round 5
+	}
+
+	uint64_t rawAt(uint64_t i) const {return squares(i, key);} // raw 64-bit number at index i
+	double at(uint64_t i) const {return toUni(squares(i, key));} // uniform-distributed random number at index i
+
+	void discard(uint64_t n) {ctr += n;} // skip the next n numbers in O(1)
+	void seek(uint64_t i) {ctr = i;} // make index i the next number to generate
+	uint64_t tell() const {return ctr;} // index of the next number to generate
+
+	uint64_t nextU64() {return squares(ctr++, key);}
+
+	double ranUni() {return toUni(nextU64());} // return the next uniform-distributed random number
+
+	void fillUni(double* out, size_t n){ // fill out[0..n) with the next n uniform-distributed random numbers
+		for (size_t i = 0; i < n; i++) // every iteration is independent, so they overlap freely
+			out[i] = toUni(squares(ctr + i, key));
+		ctr += n;
+	}
+
+	std::pair<double, double> ranGau(){ // return the next pair of Gaussian-distributed random number
+		double x1 = ranUni(); // get two uniformly distributed values
+		double x2 = ranUni();
+		return boxMuller(x1, x2);
+	}
+
+	int ranBin() {return ranUni() >= 0.5 ? 1 : 0;} // return the next binomial-distributed random number 0 or 1
+};
+
+
+
+#endif /* RANDOM_COUNTER_H_ */
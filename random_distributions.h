@@ -0,0 +1,181 @@
+/*
+ * random_distributions.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: fanchen
+ */
+
+#ifndef RANDOM_DISTRIBUTIONS_H_
+#define RANDOM_DISTRIBUTIONS_H_
+
+#include <cstddef> // size_t
+#include <cstdint> // uint64_t
+#include <utility> // std::pair<>
+#include <iostream>
+#include "random_number.h"
+
+/* Distribution objects over a BasicRandomNumber, in the manner of the <random> distributions:
+ * dist(gen) returns one value, dist.generate(gen, out, n) fills out[0..n). Unlike the calls
+ * on the generator, an object keeps what a draw produced but the caller did not use, and
+ * serves it first on the next call, so no generated value is thrown away:
+ *   UniformDist          uniform on [lo, hi), ranUni() scaled
+ *   GaussianDist         standard normal; ranGau() makes two values, the second is kept
+ *   TruncGaussianDist    standard normal conditioned on [a, b]; rejection from a
+ *                        GaussianDist where that accepts often, so rejected values cost
+ *                        half a Box-Muller pair and accepted ones are never wasted,
+ *                        otherwise ranTruncGau()
+ *   BernoulliDist        1 with probability p, from about 8 bits of the ranBits() stream
+ *                        instead of a 64-bit draw
+ * An object holds state of the sequence it is drawing, so use one object with one generator;
+ * reset() drops the kept values. save() and load() store them next to the generator's state.
+ */
+
+class UniformDist{
+private:
+	double lo, width;
+public:
+	UniformDist(double a = 0.0, double b = 1.0) : lo(a), width(b - a){}
+
+	template<class Gen>
+	double operator()(Gen& g) {return lo + width * g.ranUni();} // lo + (hi - lo) * ranUni(), exactly ranUni() for [0, 1)
+
+	template<class Gen>
+	void generate(Gen& g, double* out, size_t n){ // fill out[0..n) with the next n values, in blocks of fillUni()
+		g.fillUni(out, n);
+		if (lo != 0.0 || width != 1.0)
+			for (size_t i = 0; i < n; i++)
+				out[i] = lo + width * out[i];
+	}
+
+	void reset(){}
+};
+
+class GaussianDist{
+private:
+	double spare; // second value of the last ranGau() pair, if not handed out yet
+	bool hasSpare;
+public:
+	GaussianDist() : spare(0.0), hasSpare(false){}
+
+	template<class Gen>
+	double operator()(Gen& g){ // the values of the ranGau() pairs, one at a time: first, second, first, ...
+		if (hasSpare){
+			hasSpare = false;
+			return spare;
+		}
+		std::pair<double, double> rg = g.ranGau();
+		spare = rg.second;
+		hasSpare = true;
+		return rg.first;
+	}
+
+	/* Fill out[0..n) with the next n values: a kept value first, then pairs of fillGau()
+	 * (same values as ranGau() up to a few ulp), and for an odd remainder one more pair, whose
+	 * second value is kept for the next call.
+	 */
+	template<class Gen>
+	void generate(Gen& g, double* out, size_t n){
+		if (n == 0)
+			return;
+		size_t i = 0;
+		if (hasSpare){
+			out[i++] = spare;
+			hasSpare = false;
+		}
+		size_t even = (n - i) & ~static_cast<size_t>(1);
+		g.fillGau(out + i, even);
+		if (i + even < n)
+			out[n - 1] = (*this)(g);
+	}
+
+	void reset() {hasSpare = false;}
+
+	void save(std::ostream& out) const{
+		putRaw(out, spare);
+		putRaw(out, static_cast<uint8_t>(hasSpare));
+	}
+
+	bool load(std::istream& in){
+		double s;
+		uint8_t h;
+		if (!getRaw(in, s) || !getRaw(in, h))
+			return false;
+		spare = s;
+		hasSpare = h != 0;
+		return true;
+	}
+};
+
+class TruncGaussianDist{
+private:
+	double a, b;
+	bool rejection; // draw from gau and reject values outside [a, b]
+	GaussianDist gau;
+public:
+	/* Rejection needs 1 / P(a <= x <= b) normal values per result, at about 20 ns each; it is
+	 * used while that stays below the cost of one ranTruncGau(), i.e. for P >= 1/4.
+	 */
+	TruncGaussianDist(double lo, double hi) : a(lo), b(hi), rejection(normalCdf(hi) - normalCdf(lo) >= 0.25){}
+
+	template<class Gen>
+	double operator()(Gen& g){
+		if (!rejection)
+			return g.ranTruncGau(a, b);
+		while (true){
+			double x = gau(g);
+			if (x >= a && x <= b)
+				return x;
+		}
+	}
+
+	template<class Gen>
+	void generate(Gen& g, double* out, size_t n){
+		for (size_t i = 0; i < n; i++)
+			out[i] = (*this)(g);
+	}
+
+	void reset() {gau.reset();}
+	void save(std::ostream& out) const {gau.save(out);}
+	bool load(std::istream& in) {return gau.load(in);}
+};
+
+class BernoulliDist{
+private:
+	double p;
+public:
+	BernoulliDist(double prob = 0.5) : p(prob){}
+
+	/* Compare a uniform u with p one byte at a time, from the top: the first byte where they
+	 * differ decides u < p, which happens within the first byte with probability 255/256. The
+	 * bytes of p are exact (multiplying by 256 and removing the integer part does not round),
+	 * so the result is 1 with probability exactly p. The bytes of u come from ranBits(8), so one
+	 * generator step serves about four results.
+	 */
+	template<class Gen>
+	int operator()(Gen& g){
+		if (p >= 1)
+			return 1;
+		double q = p;
+		while (q > 0){
+			q *= 256;
+			uint32_t pb = static_cast<uint32_t>(q);
+			q -= pb;
+			uint32_t ub = g.ranBits(8);
+			if (ub != pb)
+				return ub < pb ? 1 : 0;
+		}
+		return 0; // the remaining bytes of p are 0, so u >= p
+	}
+
+	template<class Gen>
+	void generate(Gen& g, int* out, size_t n){
+		for (size_t i = 0; i < n; i++)
+			out[i] = (*this)(g);
+	}
+
+	void reset(){}
+};
+
+
+
+#endif /* RANDOM_DISTRIBUTIONS_H_ */
@@ -0,0 +1,187 @@
+/*
+ * random_ensemble.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: fanchen
+ */
+
+#ifndef RANDOM_ENSEMBLE_H_
+#define RANDOM_ENSEMBLE_H_
+
+#include <cstddef> // size_t
+#include <cstdint> // uint64_t
+#include <ctime> // std::time() for seeding purpose
+#include <vector>
+#include <algorithm> // std::min(), std::max()
+#include <atomic>
+#include <thread>
+#include "random_walk.h"
+
+enum EnsembleOutput {ENSEMBLE_ENDPOINTS = 1, ENSEMBLE_HITTING_TIMES = 2, ENSEMBLE_PATHS = 4}; // results runEnsemble() can return, combined with |
+
+/* Settings shared by every walker of an ensemble. Walker i is BasicRandomWalk(mode, gen) with
+ * gen = RandomNumber(seed, ENSEMBLE_KEY).stream(i), so its walk depends only on the seed and
+ * i, not on the number of threads or on which thread runs it. The start is (staX, staY)
+ * unless randomStart is set, in which case the walker keeps the start its constructor drew.
+ */
+struct EnsembleSpec{
+	static const uint64_t ENSEMBLE_KEY = 2; // a stream family of its own, apart from RandomRegistry's 0 and 1
+
+	uint64_t count; // number of walkers, below 2^24 (see RandomNumber::stream())
+	int mode; // 0 = uniform, 1 = Gaussian step distances
+	int steps; // steps per walker
+	StepSampler sampler; // see BasicRandomWalk::setStepSampler()
+	double width, height; // map size
+	double staX, staY; // starting point
+	bool randomStart;
+	double desX, desY; // destination
+	const DestinationSet* targets; // destination regions instead of (desX, desY) if not null, see BasicRandomWalk::setDes(const DestinationSet&)
+	uint64_t seed;
+
+	EnsembleSpec(uint64_t n, int m, int s, uint64_t sd = std::time(nullptr)) :
+		count(n), mode(m), steps(s), sampler(STEP_REJECTION), width(4.0), height(4.0), staX(0.0), staY(0.0), randomStart(false),
+		desX(0.0), desY(0.0), targets(nullptr), seed(sd){} // constructor, defaults as RandomWalk: 4 x 4 map centered on (0, 0), destination (0, 0)
+};
+
+template<class Real = double>
+struct BasicEnsembleResult{ // vectors of the outputs that were not asked for stay empty
+	std::vector<Real> endX, endY; // ENSEMBLE_ENDPOINTS: last position of walker i
+	std::vector<int> hitTime; // ENSEMBLE_HITTING_TIMES: steps walker i took to reach the destination, -1 if it did not
+	std::vector<typename BasicRandomWalk<Real>::Trajectory> paths; // ENSEMBLE_PATHS: all positions of walker i
+};
+
+typedef BasicEnsembleResult<double> EnsembleResult;
+
+/* Work-stealing scheduler over the walker indices [0, count). Each worker owns a range of
+ * indices packed into one atomic word (lo in the high half, hi in the low half). The owner
+ * takes CHUNK walkers at a time from the front of its range; a worker whose range is empty
+ * steals the back half of another worker's range. Both sides change a range by one
+ * compare-and-swap, so no index is run twice or skipped. Walkers that reach the destination
+ * early finish their ranges early, and their workers then take over the work of the others.
+ */
+class EnsembleScheduler{
+private:
+	static const uint64_t CHUNK = 16;
+
+	struct alignas(64) Range{ // one worker's range, alone in its cache line
+		std::atomic<uint64_t> word;
+	};
+	std::vector<Range> ranges;
+
+	static uint64_t pack(uint64_t lo, uint64_t hi) {return lo << 32 | hi;}
+	static uint64_t lo(uint64_t w) {return w >> 32;}
+	static uint64_t hi(uint64_t w) {return w & 0xFFFFFFFFULL;}
+
+	bool steal(unsigned self){ // move the back half of another worker's range into ours
+		for (size_t k = 1; k < ranges.size(); k++){
+			Range& victim = ranges[(self + k) % ranges.size()];
+			uint64_t w = victim.word.load(std::memory_order_acquire);
+			while (lo(w) < hi(w)){
+				uint64_t take = (hi(w) - lo(w) + 1) / 2;
+				if (victim.word.compare_exchange_weak(w, pack(lo(w), hi(w) - take), std::memory_order_acq_rel)){
+					ranges[self].word.store(pack(hi(w) - take, hi(w)), std::memory_order_release);
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+public:
+	EnsembleScheduler(uint64_t count, unsigned workers) : ranges(workers){
+		for (unsigned k = 0; k < workers; k++)
+			ranges[k].word.store(pack(count * k / workers, count * (k + 1) / workers), std::memory_order_relaxed);
+	}
+
+	// Set [first, last) to the next walkers for worker self to run; return false once there is no work left.
+	bool next(unsigned self, uint64_t& first, uint64_t& last){
+		Range& own = ranges[self];
+		while (true){
+			uint64_t w = own.word.load(std::memory_order_acquire);
+			while (lo(w) < hi(w)){
+				uint64_t end = std::min(lo(w) + CHUNK, hi(w));
+				if (own.word.compare_exchange_weak(w, pack(end, hi(w)), std::memory_order_acq_rel)){
+					first = lo(w);
+					last = end;
+					return true;
+				}
+			}
+			if (!steal(self)) // every range is empty: the walkers left are being run by their owners
+				return false;
+		}
+	}
+};
+
+/* Run spec.count walkers of spec.steps steps on threads threads (default: all cores) and
+ * return the outputs selected by what, a combination of EnsembleOutput flags. Endpoints and
+ * hitting times are taken from lazyWalk() in constant memory per walker; only
+ * ENSEMBLE_PATHS stores positions. The result is the same for any number of threads.
+ * Boundary is the walkers' boundary policy, e.g. runEnsemble<double, ReflectBoundary>(spec).
+ * Compile with -pthread.
+ */
+template<class Real = double, class Boundary = RejectBoundary>
+BasicEnsembleResult<Real> runEnsemble(const EnsembleSpec& spec, unsigned what = ENSEMBLE_ENDPOINTS, unsigned threads = std::thread::hardware_concurrency()){
+	BasicEnsembleResult<Real> res;
+	if (what & ENSEMBLE_ENDPOINTS){
+		res.endX.resize(spec.count);
+		res.endY.resize(spec.count);
+	}
+	if (what & ENSEMBLE_HITTING_TIMES)
+		res.hitTime.resize(spec.count);
+	if (what & ENSEMBLE_PATHS)
+		res.paths.resize(spec.count);
+
+	threads = std::max(threads, 1u);
+	EnsembleScheduler sched(spec.count, threads);
+	RandomNumber family(spec.seed, EnsembleSpec::ENSEMBLE_KEY);
+
+	auto work = [&](unsigned self){
+		uint64_t first, last;
+		while (sched.next(self, first, last)){
+			for (uint64_t i = first; i < last; i++){
+				BasicRandomWalk<Real, DynamicStep, Boundary> rw(spec.mode, family.stream(i));
+				rw.setDim(spec.width, spec.height);
+				if (!spec.randomStart)
+					rw.setStart(spec.staX, spec.staY);
+				rw.setDes(spec.desX, spec.desY);
+				if (spec.targets)
+					rw.setDes(*spec.targets);
+				rw.setStepSampler(spec.sampler);
+
+				Real x = 0, y = 0;
+				int n; // points of the walk, start included
+				if (what & ENSEMBLE_PATHS){
+					n = rw.walk(spec.steps, res.paths[i]);
+					x = res.paths[i].x[n - 1];
+					y = res.paths[i].y[n - 1];
+				}
+				else{
+					n = 0;
+					for (const std::pair<Real, Real>& p : rw.lazyWalk(spec.steps)){
+						x = p.first;
+						y = p.second;
+						n++;
+					}
+				}
+				if (what & ENSEMBLE_ENDPOINTS){
+					res.endX[i] = x;
+					res.endY[i] = y;
+				}
+				if (what & ENSEMBLE_HITTING_TIMES)
+					res.hitTime[i] = n > 1 && rw.atDes(x, y) ? n - 1 : -1;
+			}
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for (unsigned k = 1; k < threads; k++)
+		workers.push_back(std::thread(work, k));
+	work(0);
+	for (size_t k = 0; k < workers.size(); k++)
+		workers[k].join();
+	return res;
+}
+
+
+
+#endif /* RANDOM_ENSEMBLE_H_ */
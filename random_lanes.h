@@ -0,0 +1,157 @@
+/*
+ * random_lanes.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: fanchen
+ */
+
+#ifndef RANDOM_LANES_H_
+#define RANDOM_LANES_H_
+
+#include <cstddef> // size_t
+#include <cstdint> // uint64_t
+#include <ctime> // std::time() for seeding purpose
+#include "random_number.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+/* Bulk uniform generator running L independent middle-square lanes side by side.
+ * Lane k is exactly RandomNumber(laneSeed(seed, k)), so every lane is bit-reproducible
+ * on its own. fillUni() hands the lanes out round-robin: out[i] comes from lane i % L
+ * of the current round, and a partially consumed round is kept for the next call, so
+ * the output never depends on how the buffer is chunked.
+ * With -mavx2 (or -mavx512dq) the square-and-swap and the middle-10-digits conversion
+ * run 4 (or 8) lanes per instruction; otherwise a scalar loop over the lanes is used,
+ * which still overlaps the L independent multiply chains.
+ */
+template<size_t L = 8>
+class RandomNumberLanes{
+	static_assert(L >= 4 && L <= 16 && L % 4 == 0, "RandomNumberLanes supports 4, 8, 12 or 16 lanes");
+private:
+	alignas(64) uint64_t curr[L]; // one middle-square state per lane
+	alignas(64) double round[L]; // the last round of outputs, one per lane
+	size_t used; // number of values in round already handed out
+
+	static void stepScalar(uint64_t* x, double* out, size_t n){ // advance n lanes by one step
+		for (size_t k = 0; k < n; k++){
+			uint64_t c = x[k] * x[k];
+			c = (c >> 32 | c << 32);
+			x[k] = c;
+			out[k] = toUni(c);
+		}
+	}
+
+#if defined(__AVX2__)
+	static void stepAVX2(uint64_t* x, double* out){ // advance 4 lanes by one step
+		const __m256i lo32 = _mm256_set1_epi64x(0xFFFFFFFF);
+		__m256i c = _mm256_load_si256(reinterpret_cast<__m256i*>(x));
+
+		// c * c mod 2^64 = lo * lo + 2 * (lo * hi) << 32
+		__m256i hi = _mm256_srli_epi64(c, 32);
+		__m256i sq = _mm256_add_epi64(_mm256_mul_epu32(c, c), _mm256_slli_epi64(_mm256_mul_epu32(c, hi), 33));
+		c = _mm256_shuffle_epi32(sq, 0xB1); // swap the 32-bit halves
+		_mm256_store_si256(reinterpret_cast<__m256i*>(x), c);
+
+		// q = c / 10^15 estimated from the high half alone (hi * 2^32 / 10^15), which is off by at most one
+		const __m256d two52 = _mm256_set1_pd(4503599627370496.0);
+		__m256d hd = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(_mm256_srli_epi64(c, 32), _mm256_castpd_si256(two52))), two52);
+		__m256d qd = _mm256_floor_pd(_mm256_mul_pd(hd, _mm256_set1_pd(4294967296.0 / 1e15)));
+		__m256i q = _mm256_and_si256(_mm256_castpd_si256(_mm256_add_pd(qd, two52)), lo32); // q < 2^15 sits in the low mantissa bits
+		const __m256i mod = _mm256_set1_epi64x(1000000000000000LL);
+		__m256i prod = _mm256_add_epi64(_mm256_mul_epu32(q, mod), _mm256_slli_epi64(_mm256_mul_epu32(q, _mm256_srli_epi64(mod, 32)), 32));
+		__m256i r = _mm256_sub_epi64(c, prod);
+		// r = c % 10^15 after fixing the estimate
+		r = _mm256_add_epi64(r, _mm256_and_si256(_mm256_cmpgt_epi64(_mm256_setzero_si256(), r), mod)); // r < 0: q was one too big
+		r = _mm256_sub_epi64(r, _mm256_and_si256(_mm256_cmpgt_epi64(r, _mm256_set1_epi64x(999999999999999LL)), mod)); // r >= 10^15: q was one too small
+
+		// r < 2^50 converts exactly, and so do the products below, so the quotient estimate can be fixed exactly
+		__m256d rd = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(r, _mm256_castpd_si256(two52))), two52);
+		const __m256d e5 = _mm256_set1_pd(100000.0);
+		const __m256d one = _mm256_set1_pd(1.0);
+		__m256d mid = _mm256_floor_pd(_mm256_mul_pd(rd, _mm256_set1_pd(1e-5)));
+		mid = _mm256_sub_pd(mid, _mm256_and_pd(_mm256_cmp_pd(_mm256_mul_pd(mid, e5), rd, _CMP_GT_OQ), one));
+		mid = _mm256_add_pd(mid, _mm256_and_pd(_mm256_cmp_pd(_mm256_mul_pd(_mm256_add_pd(mid, one), e5), rd, _CMP_LE_OQ), one));
+#if defined(__FMA__)
+		// mid / 10^10 correctly rounded: one FMA residual correction of mid * 10^-10 (checked exhaustively for all 10^10 values of mid)
+		__m256d u = _mm256_mul_pd(mid, _mm256_set1_pd(1e-10));
+		u = _mm256_fmadd_pd(_mm256_fnmadd_pd(u, _mm256_set1_pd(10000000000.0), mid), _mm256_set1_pd(1e-10), u);
+		_mm256_storeu_pd(out, u);
+#else
+		_mm256_storeu_pd(out, _mm256_div_pd(mid, _mm256_set1_pd(10000000000.0)));
+#endif
+	}
+#endif
+
+#if defined(__AVX512F__) && defined(__AVX512DQ__)
+	static void stepAVX512(uint64_t* x, double* out){ // advance 8 lanes by one step
+		__m512i c = _mm512_load_si512(x);
+		c = _mm512_ror_epi64(_mm512_mullo_epi64(c, c), 32);
+		_mm512_store_si512(x, c);
+
+		const __m512i mod = _mm512_set1_epi64(1000000000000000LL);
+		__m512i q = _mm512_cvttpd_epu64(_mm512_mul_pd(_mm512_cvtepu64_pd(c), _mm512_set1_pd(1e-15)));
+		__m512i r = _mm512_sub_epi64(c, _mm512_mullo_epi64(q, mod));
+		r = _mm512_mask_add_epi64(r, _mm512_cmplt_epi64_mask(r, _mm512_setzero_si512()), r, mod);
+		r = _mm512_mask_sub_epi64(r, _mm512_cmpge_epi64_mask(r, mod), r, mod);
+
+		__m512d rd = _mm512_cvtepi64_pd(r);
+		const __m512d e5 = _mm512_set1_pd(100000.0);
+		const __m512d one = _mm512_set1_pd(1.0);
+		__m512d mid = _mm512_roundscale_pd(_mm512_mul_pd(rd, _mm512_set1_pd(1e-5)), _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+		mid = _mm512_mask_sub_pd(mid, _mm512_cmp_pd_mask(_mm512_mul_pd(mid, e5), rd, _CMP_GT_OQ), mid, one);
+		mid = _mm512_mask_add_pd(mid, _mm512_cmp_pd_mask(_mm512_mul_pd(_mm512_add_pd(mid, one), e5), rd, _CMP_LE_OQ), mid, one);
+		__m512d u = _mm512_mul_pd(mid, _mm512_set1_pd(1e-10));
+		u = _mm512_fmadd_pd(_mm512_fnmadd_pd(u, _mm512_set1_pd(10000000000.0), mid), _mm512_set1_pd(1e-10), u);
+		_mm512_storeu_pd(out, u);
+	}
+#endif
+
+	void step(double* out){ // advance every lane once, writing L values to out
+		size_t k = 0;
+#if defined(__AVX512F__) && defined(__AVX512DQ__)
+		for (; k + 8 <= L; k += 8)
+			stepAVX512(curr + k, out + k);
+#endif
+#if defined(__AVX2__)
+		for (; k + 4 <= L; k += 4)
+			stepAVX2(curr + k, out + k);
+#endif
+		stepScalar(curr + k, out + k, L - k);
+	}
+
+public:
+	static const size_t LANES = L;
+
+	static uint64_t laneSeed(uint64_t seed, size_t k){ // seed of lane k, decorrelated with the splitmix64 finalizer
+		return mix64(seed + (k + 1) * 0x9E3779B97F4A7C15ULL);
+	}
+
+	RandomNumberLanes(uint64_t seed = std::time(nullptr)) : used(L){ // constructor, seed every lane from one seed
+		for (size_t k = 0; k < L; k++)
+			curr[k] = laneSeed(seed, k);
+	}
+
+	double ranUni(){ // return the next value of the round-robin stream
+		if (used == L){
+			step(round);
+			used = 0;
+		}
+		return round[used++];
+	}
+
+	void fillUni(double* out, size_t n){ // fill out[0..n) with the next n values of the round-robin stream
+		size_t i = 0;
+		for (; i < n && used < L; i++) // drain the current round first
+			out[i] = round[used++];
+		for (; i + L <= n; i += L) // whole rounds are written straight to out
+			step(out + i);
+		for (; i < n; i++)
+			out[i] = ranUni();
+	}
+};
+
+
+
+#endif /* RANDOM_LANES_H_ */
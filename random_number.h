@@ -11,18 +11,145 @@
 #define _USE_MATH_DEFINES
 
 #include <iostream>
+#include <cstddef> // size_t
+#include <cstdlib> // exit()
+#include <cstdint> // uint64_t
 #include <ctime> // std::time() for seeding purpose
 #include <utility> // std::pair<>
 #include <cmath> // std::log(), std::abs()
+#include <algorithm> // std::min()
+#include <string>
+#include <fstream> // save() and load() of generator states
+#include "fast_math.h" // fastLog(), fastSinCos2Pi(), sqrtArray()
 
-class RandomNumber{
+enum GauMethod {BOX_MULLER, ZIGGURAT}; // algorithms ranGau() can use to produce Gaussian-distributed random numbers
+enum UniMode {UNI_LEGACY, UNI_CLOSED_OPEN, UNI_OPEN, UNI_CLOSED}; // conversions ranUni() can use to turn 64 raw bits into a double
+
+/* Lookup tables of the 128-layer ziggurat for the standard normal distribution
+ * (J. A. Doornik, "An Improved Ziggurat Method to Generate Normal Random Samples", 2005).
+ * x[i] is the right edge of layer i (x[0] is the bottom layer's pseudo-edge V / f(R)),
+ * and r[i] = x[i + 1] / x[i] is the fraction of layer i that lies fully under the curve.
+ */
+struct ZigguratTable{
+	static const int LAYERS = 128;
+	double x[LAYERS + 1];
+	double r[LAYERS];
+
+	ZigguratTable(){
+		const double R = 3.442619855899; // start of the tail
+		const double V = 9.91256303526217e-3; // area of every layer
+		double f = std::exp(-0.5 * R * R);
+		x[0] = V / f;
+		x[1] = R;
+		x[LAYERS] = 0;
+		for (int i = 2; i < LAYERS; i++){
+			x[i] = std::sqrt(-2 * std::log(V / x[i - 1] + f));
+			f = std::exp(-0.5 * x[i] * x[i]);
+		}
+		for (int i = 0; i < LAYERS; i++)
+			r[i] = x[i + 1] / x[i];
+	}
+
+	static const ZigguratTable& get(){ // built once, on first use
+		static const ZigguratTable table;
+		return table;
+	}
+};
+
+/* Set-up of a Binomial(n, p) sampler, computed once per (n, p) so that batches do not repeat it.
+ * p is folded to r = min(p, 1 - p). When n * r < 30 the sampler inverts the CDF (expected
+ * O(n * r) = O(1) work), otherwise it uses the BTPE algorithm of Kachitvichyanukul and
+ * Schmeiser ("Binomial Random Variate Generation", CACM 31(2), 1988), whose expected number
+ * of iterations is bounded for all n. The constants follow the paper's notation.
+ */
+struct BinomialParams{
+	int n;
+	double p;
+	double r, q; // r = min(p, 1 - p), q = 1 - r
+	bool inversion;
+	// inversion set-up
+	double qn, bound;
+	// BTPE set-up
+	int m;
+	double fm, nrq, p1, xm, xl, xr, c, laml, lamr, p2, p3, p4;
+
+	BinomialParams(int trials, double prob) : n(trials), p(prob){
+		r = std::min(p, 1.0 - p);
+		q = 1.0 - r;
+		inversion = n * r < 30;
+		if (inversion){
+			qn = std::exp(n * std::log(q));
+			double np = n * r;
+			bound = std::min(static_cast<double>(n), np + 10.0 * std::sqrt(np * q + 1));
+			return;
+		}
+		fm = n * r + r;
+		m = static_cast<int>(std::floor(fm));
+		nrq = n * r * q;
+		p1 = std::floor(2.195 * std::sqrt(nrq) - 4.6 * q) + 0.5;
+		xm = m + 0.5;
+		xl = xm - p1;
+		xr = xm + p1;
+		c = 0.134 + 20.5 / (15.3 + m);
+		double a = (fm - xl) / (fm - xl * r);
+		laml = a * (1.0 + a / 2.0);
+		a = (xr - fm) / (xr * q);
+		lamr = a * (1.0 + a / 2.0);
+		p2 = p1 * (1.0 + 2.0 * c);
+		p3 = p2 + c / laml;
+		p4 = p3 + c / lamr;
+	}
+};
+
+inline uint64_t mix64(uint64_t z){ // splitmix64 finalizer, a bijection with mix64(0) == 0
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+// Raw binary I/O of trivially copyable values, used by the save() and load() functions of the
+// generators, the walks and the seed tables. Files are only meant to be read back on a machine
+// with the same byte order.
+template<class T>
+inline void putRaw(std::ostream& out, const T& v) {out.write(reinterpret_cast<const char*>(&v), sizeof v);}
+template<class T>
+inline bool getRaw(std::istream& in, T& v) {return static_cast<bool>(in.read(reinterpret_cast<char*>(&v), sizeof v));}
+
+class SeedTable; // table of bad seeds of the original mode, see random_seeds.h
+class RandomWalkLanes; // SIMD walk kernel, see random_walk_lanes.h
+
+/* The middle-square engine: raw 64-bit square-and-swap results, with an optional Weyl sequence.
+ * It meets the std::uniform_random_bit_generator requirements, so it can drive std::shuffle,
+ * the std::*_distribution classes, and the free functions and BasicRandomNumber below.
+ */
+class MiddleSquareEngine{
 private:
 	uint64_t curr;
+	uint64_t weyl; // Weyl sequence counter, advanced by key on every step
+	uint64_t key; // Weyl increment (always odd in Weyl mode); 0 keeps the original square-and-swap sequence
+	uint64_t base; // seed the generator (and its family of substreams) started from
+	uint64_t splits; // number of substreams already handed out by split()
+	friend class RandomWalkLanes; // steps the state in SIMD lanes
 public:
-	RandomNumber(uint64_t seed = std::time(nullptr)) : curr(seed){} // constructor, set curr value. default seed is current time
+	typedef uint64_t result_type;
+	static const int STREAM_BITS = 40; // substream k owns the Weyl counter values k * 2^40 to (k + 1) * 2^40 - 1
+	static const uint64_t MAX_STREAMS = 1ULL << (64 - STREAM_BITS); // 2^24 substreams fill the counter
+	static const uint64_t DEFAULT_KEY = 0xb5ad4eceda1ce2a9ULL; // mixed into every key, so that key 0 is a good key too
+
+	static constexpr result_type min() {return 0;}
+	static constexpr result_type max() {return ~static_cast<result_type>(0);}
+
+	explicit MiddleSquareEngine(uint64_t seed = std::time(nullptr)) :
+		curr(seed), weyl(0), key(0), base(seed), splits(0){} // constructor, set curr value. default seed is current time
+
+	MiddleSquareEngine(uint64_t seed, uint64_t k) :
+		curr(seed), weyl(0), key(mix64(k ^ DEFAULT_KEY) | 1), base(seed), splits(0){} // constructor for Weyl mode, k is the stream key (scrambled and made odd)
+
+	MiddleSquareEngine(uint64_t seed, const SeedTable& table); // constructor for the original mode, replaces seeds the table marks bad (random_seeds.h)
 
-	double ranUni(){ // return the next uniform-distributed random number between 0 (exclusive) and 1 (exclusive)
+	result_type operator()(){ // advance curr by one square-and-swap step and return it
 		curr *= curr;
+		curr += (weyl += key); // Weyl sequence, which guarantees a period of 2^64. No-op in the original mode (key == 0)
 
 		/* Inspired by "Middle Square Weyl Sequence PRNG" described in
 		 * https://en.wikipedia.org/wiki/Middle-square_method
@@ -32,21 +159,563 @@ public:
 		 * become unsuitable for generating pseudo-random number
 		 */
 		curr = (curr >> 32 | curr << 32);
+		return curr;
+	}
+
+	/* Return substream k (0 <= k < 2^24) of this generator's family, i.e. the Weyl-mode
+	 * generator with the same seed and key whose counter starts at k * 2^40 * key.
+	 * Since key is odd, n -> n * key is a bijection on 64-bit integers, so as long as each
+	 * substream draws fewer than 2^40 numbers, no two substreams ever visit the same
+	 * counter value and therefore never share a generator state. Substream 0 is
+	 * MiddleSquareEngine(seed, key) itself. A generator in the original mode uses the key of
+	 * MiddleSquareEngine(seed, 0). The starting curr is also scrambled with k so that
+	 * neighbouring substreams do not begin with nearly equal numbers.
+	 * k >= 2^24 would wrap the counter onto the range of substream k mod 2^24, so it is an
+	 * error, like an invalid mode of RandomWalk.
+	 */
+	MiddleSquareEngine stream(uint64_t k) const{
+		if (k >= MAX_STREAMS){
+			std::cerr << "Error in RandomNumber.stream: substream " << k << " is not below 2^24" << std::endl;
+			exit(1);
+		}
+		MiddleSquareEngine s(base ^ mix64(k), 0);
+		if (key)
+			s.key = key;
+		s.base = base;
+		s.weyl = (k << STREAM_BITS) * s.key;
+		return s;
+	}
+
+	// Return the next unused substream (1, 2, 3, ...). Hand substreams out from one owner only:
+	// split() on two different generators of the same family returns the same substreams.
+	MiddleSquareEngine split() {return stream(++splits);}
+
+	// Write the complete state (40 bytes) to out; load() restores it, so the restored engine
+	// continues with exactly the numbers the saved one would have produced.
+	void save(std::ostream& out) const{
+		putRaw(out, curr);
+		putRaw(out, weyl);
+		putRaw(out, key);
+		putRaw(out, base);
+		putRaw(out, splits);
+	}
+
+	bool load(std::istream& in){ // return false and leave the engine unchanged if the state cannot be read
+		uint64_t s[5];
+		for (int i = 0; i < 5; i++)
+			if (!getRaw(in, s[i]))
+				return false;
+		curr = s[0]; weyl = s[1]; key = s[2]; base = s[3]; splits = s[4];
+		return true;
+	}
+};
+
+// Number of whole random bits in one call of an engine whose outputs span range + 1 values.
+constexpr int engineBits(uint64_t range) {return range == ~0ULL ? 64 : (range + 1 < 2 ? 0 : 1 + engineBits((range + 1) / 2 - 1));}
+
+/* Return 64 random bits from any uniform random bit generator g (e.g. MiddleSquareEngine,
+ * std::mt19937, std::mt19937_64). Engines with a full 64-bit range are called once; others
+ * are called as often as needed. If the range of g is not a power of two, the bits taken from
+ * each call are very slightly biased; wrap such engines in std::independent_bits_engine.
+ */
+template<class URBG>
+inline uint64_t ranU64(URBG& g){
+	const uint64_t range = static_cast<uint64_t>(URBG::max() - URBG::min());
+	const int bits = engineBits(range);
+	if (bits == 64)
+		return static_cast<uint64_t>(g() - URBG::min());
+	const int shift = bits & 63; // bits < 64 here; the mask keeps the 64-bit instantiations free of shift warnings
+	const uint64_t mask = ~0ULL >> ((64 - bits) & 63);
+	uint64_t res = 0;
+	for (int have = 0; have < 64; have += bits)
+		res = (res << shift) | (static_cast<uint64_t>(g() - URBG::min()) & mask);
+	return res;
+}
+
+// Take the middle 10 digits of a square-and-swap result to form the uniform-distributed random number.
+inline double toUni(uint64_t x) {return ((x % 1000000000000000) / 100000) / 10000000000.0;}
+
+/* Division-free conversions of 64 raw bits: the top bits are shifted down and scaled by a
+ * power of two, which is exact and gives a uniform grid. The closed interval scales by the
+ * double nearest 1 / (2^53 - 1) instead, so the largest value maps to exactly 1 (as does the
+ * one below it; the other results are within half an ulp of k / (2^53 - 1)).
+ */
+inline double toUni53(uint64_t x) {return (x >> 11) * (1.0 / 9007199254740992.0);} // [0, 1), multiples of 2^-53
+inline double toUniOpen(uint64_t x) {return ((x >> 11) | 1) * (1.0 / 9007199254740992.0);} // (0, 1), odd multiples of 2^-53, never 0 or 1
+inline double toUniClosed(uint64_t x) {return (x >> 11) * (1.0 / 9007199254740991.0);} // [0, 1], multiples of 1 / (2^53 - 1)
+inline float toUniF(uint64_t x) {return (x >> 40) * (1.0f / 16777216.0f);} // [0, 1) as a float, multiples of 2^-24
+
+/* The conversions above keep the top bits, so BasicRandomNumber first makes sure the engine's
+ * top bits are good ones. For most engines all bits are equally good. A middle-square result
+ * has the low half of the square on top, and in the original mode its low 21 bits are biased
+ * (bit 1 of a square is always 0, bit 2 is mostly 0, ...); folding the well-mixed high half of
+ * the square (the low half of the result) onto them removes the bias.
+ */
+template<class Engine>
+inline uint64_t topBits(uint64_t x) {return x;}
+
+template<>
+inline uint64_t topBits<MiddleSquareEngine>(uint64_t x) {return x ^ (x << 32);}
+
+inline std::pair<double, double> boxMuller(double x1, double x2){ // turn two uniformly distributed values into two Gaussian ones
+	return std::make_pair(std::sqrt(-2 * std::log(x1)) * std::cos(2 * M_PI * x2), std::sqrt(-2 * std::log(x1)) * std::sin(2 * M_PI * x2));
+}
+
+inline double normalCdf(double x) {return 0.5 * std::erfc(-x / std::sqrt(2.0));}
+
+/* Inverse of normalCdf() for 0 < p < 1: P. J. Acklam's rational approximation (relative
+ * error 1.2e-9), refined by one Halley step to the accuracy of std::erfc() (normalCdf(x) is
+ * within 4e-15 of p relative for p >= 1e-6, 3e-13 down to 1e-300). p above 1/2 is mirrored,
+ * so the refinement always works with the smaller, exactly represented tail.
+ */
+inline double normalQuantile(double p){
+	if (p > 0.5)
+		return -normalQuantile(1 - p);
+	static const double a[] = {-3.969683028665376e+01, 2.209460984245205e+02, -2.759285104469687e+02, 1.383577518672690e+02, -3.066479806614716e+01, 2.506628277459239e+00};
+	static const double b[] = {-5.447609879822406e+01, 1.615858368580409e+02, -1.556989798598866e+02, 6.680131188771972e+01, -1.328068155288572e+01};
+	static const double c[] = {-7.784894002430293e-03, -3.223964580411365e-01, -2.400758277161838e+00, -2.549732539343734e+00, 4.374664141464968e+00, 2.938163982698783e+00};
+	static const double d[] = {7.784695709041462e-03, 3.224671290700398e-01, 2.445134137142996e+00, 3.754408661907416e+00};
+	double x;
+	if (p < 0.02425){ // lower tail
+		double q = std::sqrt(-2 * std::log(p));
+		x = (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) / ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1);
+	}
+	else{ // central region
+		double q = p - 0.5, r = q * q;
+		x = (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r + a[5]) * q / (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1);
+	}
+	double e = normalCdf(x) - p;
+	double u = e * std::sqrt(2 * M_PI) * std::exp(0.5 * x * x);
+	return x - u / (1 + 0.5 * x * u);
+}
+
+// Free versions of the basic draws, for any uniform random bit generator. With a MiddleSquareEngine
+// they give the same numbers as the RandomNumber members (except ranBin(), which has no bit reservoir).
+template<class URBG>
+inline double ranUni(URBG& g) {return toUni(ranU64(g));} // uniform-distributed random number between 0 and 1
+
+template<class URBG>
+inline std::pair<double, double> ranGau(URBG& g){ // pair of Gaussian-distributed random numbers, Box-Muller transform
+	double x1 = ranUni(g);
+	double x2 = ranUni(g);
+	return boxMuller(x1, x2);
+}
+
+template<class URBG>
+inline int ranBin(URBG& g) {return static_cast<int>(ranU64(g) & 1);} // binomial-distributed random number 0 or 1
+
+/* Generator front-end over any engine meeting the std::uniform_random_bit_generator
+ * requirements (result_type, min(), max(), operator()). RandomNumber is the middle-square
+ * instance; BasicRandomNumber<std::mt19937_64> and BasicRandomNumber<CounterRandomNumber>
+ * run the same code on other engines. The front-end itself is a 64-bit uniform random bit
+ * generator too.
+ */
+template<class Engine>
+class BasicRandomNumber{
+private:
+	Engine eng;
+	GauMethod gauMethod; // algorithm used by ranGau()
+	UniMode uniMode; // conversion used by ranUni() and fillUni()
+	uint64_t bitBuf; // random bits not handed out yet, lowest bit first
+	int bitCnt; // number of valid bits in bitBuf
+	friend class RandomWalkLanes; // steps the state in SIMD lanes
+
+	uint64_t nextTop() {return topBits<Engine>(nextU64());} // next raw bits, best bits on top, for the division-free conversions
+
+	double uniOpen() {return toUniOpen(nextTop());} // uniform on (0, 1), never 0 or 1
+
+	// Uniforms fed to Box-Muller: the legacy ones keep old seeds reproducible, the other modes
+	// use the open interval so that log(0) cannot occur.
+	double gauUni() {return uniMode == UNI_LEGACY ? toUni(nextU64()) : toUniOpen(nextTop());}
+
+	template<class Convert>
+	void fillWith(double* out, size_t n, Convert convert, bool top){ // fill out[0..n) with converted raw bits, one loop per conversion
+		if (top){
+			for (size_t i = 0; i < n; i++)
+				out[i] = convert(nextTop());
+		}
+		else{
+			for (size_t i = 0; i < n; i++)
+				out[i] = convert(nextU64());
+		}
+	}
+
+	double gauZigTail(bool negative){ // sample from the normal tail beyond the ziggurat's bottom layer
+		const double R = ZigguratTable::get().x[1];
+		double x, y;
+		do{
+			x = std::log(uniOpen()) / R;
+			y = std::log(uniOpen());
+		} while (-2 * y < x * x);
+		return negative ? x - R : R - x;
+	}
+
+	int binomInversion(const BinomialParams& bp){ // Binomial(n, r) by sequential search of the CDF
+		while (true){
+			int x = 0;
+			double px = bp.qn;
+			double u = uniOpen();
+			while (u > px){
+				x++;
+				if (x > bp.bound) // the remaining mass is negligible, start over
+					break;
+				u -= px;
+				px = ((bp.n - x + 1) * bp.r * px) / (x * bp.q);
+			}
+			if (x <= bp.bound)
+				return x;
+		}
+	}
+
+	static double stirlingTail(double x){ // correction term of Stirling's formula used by BTPE, (1/12 - 1/(360 x^2) + ...) / x with 166320 / 12 = 13860
+		double x2 = x * x;
+		return (13860. - (462. - (132. - (99. - 140. / x2) / x2) / x2) / x2) / x / 166320.;
+	}
+
+	int binomBTPE(const BinomialParams& bp){ // Binomial(n, r) by BTPE, r * n >= 30
+		while (true){
+			double u = uniOpen() * bp.p4;
+			double v = uniOpen();
+			int y;
+			if (u <= bp.p1) // triangular region, accept at once
+				return static_cast<int>(std::floor(bp.xm - bp.p1 * v + u));
+			if (u <= bp.p2){ // parallelograms
+				double x = bp.xl + (u - bp.p1) / bp.c;
+				v = v * bp.c + 1.0 - std::abs(bp.m - x + 0.5) / bp.p1;
+				if (v > 1.0)
+					continue;
+				y = static_cast<int>(std::floor(x));
+			}
+			else if (u <= bp.p3){ // left exponential tail
+				double x = std::floor(bp.xl + std::log(v) / bp.laml);
+				if (x < 0)
+					continue;
+				y = static_cast<int>(x);
+				v = v * (u - bp.p2) * bp.laml;
+			}
+			else{ // right exponential tail
+				double x = std::floor(bp.xr - std::log(v) / bp.lamr);
+				if (x > bp.n)
+					continue;
+				y = static_cast<int>(x);
+				v = v * (u - bp.p3) * bp.lamr;
+			}
+
+			int k = std::abs(y - bp.m);
+			if (k <= 20 || k >= bp.nrq / 2.0 - 1){ // evaluate f(y) / f(m) by its recursion
+				double s = bp.r / bp.q;
+				double a = s * (bp.n + 1);
+				double f = 1.0;
+				if (bp.m < y){
+					for (int i = bp.m + 1; i <= y; i++)
+						f *= (a / i - s);
+				}
+				else if (bp.m > y){
+					for (int i = y + 1; i <= bp.m; i++)
+						f /= (a / i - s);
+				}
+				if (v <= f)
+					return y;
+				continue;
+			}
+
+			// squeeze on log(f(y) / f(m)), then the final test with Stirling's formula
+			double rho = (k / bp.nrq) * ((k * (k / 3.0 + 0.625) + 0.16666666666666666) / bp.nrq + 0.5);
+			double t = -static_cast<double>(k) * k / (2 * bp.nrq);
+			double lv = std::log(v);
+			if (lv < t - rho)
+				return y;
+			if (lv > t + rho)
+				continue;
+			double x1 = y + 1, f1 = bp.m + 1, z = bp.n + 1 - bp.m, w = bp.n - y + 1;
+			if (lv <= bp.xm * std::log(f1 / x1) + (bp.n - bp.m + 0.5) * std::log(z / w) + (y - bp.m) * std::log(w * bp.r / (x1 * bp.q))
+					+ stirlingTail(f1) + stirlingTail(z) - stirlingTail(x1) - stirlingTail(w)) // log(f(y) / f(m)): + for the factorials of f(m), - for those of f(y)
+				return y;
+		}
+	}
+public:
+	typedef uint64_t result_type;
+	static constexpr result_type min() {return 0;}
+	static constexpr result_type max() {return ~static_cast<result_type>(0);}
+	static const uint64_t STATE_MAGIC = 0x545353474E52534DULL; // "MSRNGSST", first 8 bytes of a saved generator file
+
+	BasicRandomNumber(uint64_t seed = std::time(nullptr)) :
+		eng(seed), gauMethod(BOX_MULLER), uniMode(UNI_LEGACY), bitBuf(0), bitCnt(0){} // constructor, seed the engine. default seed is current time
+
+	BasicRandomNumber(uint64_t seed, uint64_t k) :
+		eng(seed, k), gauMethod(BOX_MULLER), uniMode(UNI_LEGACY), bitBuf(0), bitCnt(0){} // constructor for engines with a stream key, e.g. the Weyl mode of MiddleSquareEngine
+
+	BasicRandomNumber(uint64_t seed, const SeedTable& table) :
+		eng(seed, table), gauMethod(BOX_MULLER), uniMode(UNI_LEGACY), bitBuf(0), bitCnt(0){} // constructor checking the seed against a table of bad seeds (random_seeds.h)
+
+	explicit BasicRandomNumber(const Engine& e) :
+		eng(e), gauMethod(BOX_MULLER), uniMode(UNI_LEGACY), bitBuf(0), bitCnt(0){} // constructor from an engine in any state
+
+	Engine& engine() {return eng;}
+	const Engine& engine() const {return eng;}
+
+	uint64_t nextU64() {return ranU64(eng);} // return the next 64 raw bits of the engine
+	result_type operator()() {return nextU64();}
+
+	// substreams of engines that have them (see MiddleSquareEngine::stream())
+	BasicRandomNumber stream(uint64_t k) const {return BasicRandomNumber(eng.stream(k));}
+	BasicRandomNumber split() {return BasicRandomNumber(eng.split());}
+
+	/* Checkpointing: save() writes the engine state, the chosen methods and the buffered bits
+	 * of ranBits(); load() restores them, after which every call returns exactly what it would
+	 * have returned on the saved generator. The engine must have save() and load() (e.g.
+	 * MiddleSquareEngine). The file versions add a magic number; all of them return false and
+	 * leave the generator unchanged on failure.
+	 */
+	void save(std::ostream& out) const{
+		eng.save(out);
+		putRaw(out, static_cast<int32_t>(gauMethod));
+		putRaw(out, static_cast<int32_t>(uniMode));
+		putRaw(out, bitBuf);
+		putRaw(out, static_cast<int32_t>(bitCnt));
+	}
+
+	bool load(std::istream& in){
+		Engine e(eng);
+		int32_t gm, um, cnt;
+		uint64_t buf;
+		if (!e.load(in) || !getRaw(in, gm) || !getRaw(in, um) || !getRaw(in, buf) || !getRaw(in, cnt))
+			return false;
+		if (gm < BOX_MULLER || gm > ZIGGURAT || um < UNI_LEGACY || um > UNI_CLOSED || cnt < 0 || cnt > 64) // a corrupt or foreign file
+			return false;
+		eng = e;
+		gauMethod = static_cast<GauMethod>(gm);
+		uniMode = static_cast<UniMode>(um);
+		bitBuf = buf;
+		bitCnt = cnt;
+		return true;
+	}
+
+	bool save(const std::string& path) const{
+		std::ofstream out(path.c_str(), std::ios::binary);
+		uint64_t magic = STATE_MAGIC;
+		putRaw(out, magic);
+		save(out);
+		return static_cast<bool>(out);
+	}
+
+	bool load(const std::string& path){
+		std::ifstream in(path.c_str(), std::ios::binary);
+		uint64_t magic;
+		return getRaw(in, magic) && magic == STATE_MAGIC && load(in);
+	}
+
+	void setUniMode(UniMode m) {uniMode = m;} // choose the conversion used by ranUni() and fillUni(), default UNI_LEGACY
+	UniMode getUniMode() const {return uniMode;}
 
-		// Take the middle 10 digits to form the uniform-distributed random number.
-		return ((curr % 1000000000000000) / 100000) / 10000000000.0;
+	/* Return the next uniform-distributed random number between 0 and 1:
+	 *   UNI_LEGACY       middle 10 decimal digits of the raw bits, the original sequence of every seed
+	 *   UNI_CLOSED_OPEN  [0, 1), 53 bits
+	 *   UNI_OPEN         (0, 1), 52 bits (odd multiples of 2^-53)
+	 *   UNI_CLOSED       [0, 1], 53 bits
+	 */
+	double ranUni(){
+		switch (uniMode){
+		case UNI_CLOSED_OPEN: return toUni53(nextTop());
+		case UNI_OPEN: return toUniOpen(nextTop());
+		case UNI_CLOSED: return toUniClosed(nextTop());
+		default: return toUni(nextU64());
+		}
 	}
 
+	float ranUniF() {return toUniF(nextTop());} // return the next uniform-distributed random number in [0, 1) as a float, 24 bits
+
+	void fillUniF(float* out, size_t n){ // fill out[0..n) with the next n floats of ranUniF()
+		for (size_t i = 0; i < n; i++)
+			out[i] = toUniF(nextTop());
+	}
+
+	void fillUni(double* out, size_t n){ // fill out[0..n) with the next n uniform-distributed random numbers, same sequence as calling ranUni() n times
+		switch (uniMode){
+		case UNI_CLOSED_OPEN: fillWith(out, n, toUni53, true); break;
+		case UNI_OPEN: fillWith(out, n, toUniOpen, true); break;
+		case UNI_CLOSED: fillWith(out, n, toUniClosed, true); break;
+		default: fillWith(out, n, toUni, false); break;
+		}
+	}
+
+	double ranGauZig(){ // return the next Gaussian-distributed random number, using the ziggurat method
+		const ZigguratTable& zt = ZigguratTable::get();
+		while (true){
+			uint64_t bits = nextTop(); // as the other conversions, so the biased bits of the original mode are folded away
+			int i = bits & 0x7F; // low 7 bits pick the layer
+			double u = (bits >> 11) * (2.0 / 9007199254740992.0) - 1; // top 53 bits give u in [-1, 1)
+			if (std::abs(u) < zt.r[i]) // inside the part of the layer fully under the curve, no transcendental call needed (~99% of draws)
+				return u * zt.x[i];
+			if (i == 0) // bottom layer: sample from the tail
+				return gauZigTail(u < 0);
+			// otherwise the point is in a wedge, accept it if it falls under the curve
+			double x = u * zt.x[i];
+			double f0 = std::exp(-0.5 * (zt.x[i] * zt.x[i] - x * x));
+			double f1 = std::exp(-0.5 * (zt.x[i + 1] * zt.x[i + 1] - x * x));
+			if (f1 + uniOpen() * (f0 - f1) < 1.0)
+				return x;
+		}
+	}
+
+	/* Return a standard normal random number conditioned on a <= x <= b (a <= b, either may be
+	 * infinite), without rejection: one uniform is mapped through the inverse CDF, using the
+	 * upper tail for intervals above 0 (and the mirror image below) so that no precision is lost
+	 * to 1 - CDF. Intervals starting beyond 37 standard deviations, where the tail probability
+	 * underflows, use Robert's exponential proposal truncated to [a, b], accepted with
+	 * probability above 0.999 there. Cost is bounded for every interval, however narrow or far.
+	 * A single point a == b (e.g. [0, 0] on a map of zero width) returns a, still using one uniform.
+	 */
+	double ranTruncGau(double a, double b){
+		if (a == b){
+			uniOpen(); // keep the stream in step with other intervals
+			return a;
+		}
+		if (b <= 0 && a < 0) // strict, so that [-0, 0] does not mirror onto itself
+			return -ranTruncGau(-b, -a);
+		double x;
+		if (a >= 0){ // upper tail: Q(x) = normalCdf(-x)
+			double qa = normalCdf(-a), qb = normalCdf(-b);
+			if (qa < 1e-300){
+				double alpha = 0.5 * (a + std::sqrt(a * a + 4));
+				double span = 1 - std::exp(-alpha * (b - a)); // exponential mass on [a, b], 1 for b = infinity
+				do
+					x = a - std::log1p(-uniOpen() * span) / alpha;
+				while (uniOpen() > std::exp(-0.5 * (x - alpha) * (x - alpha)));
+			}
+			else
+				x = -normalQuantile(qb + uniOpen() * (qa - qb));
+		}
+		else{
+			double pa = normalCdf(a), pb = normalCdf(b);
+			x = normalQuantile(pa + uniOpen() * (pb - pa));
+		}
+		return std::min(std::max(x, a), b); // rounding can push x just outside
+	}
+
+	void setGauMethod(GauMethod m) {gauMethod = m;} // choose the algorithm used by ranGau(), default BOX_MULLER
+	GauMethod getGauMethod() const {return gauMethod;}
+
 	std::pair<double, double> ranGau(){ // return the next pair of Gaussian-distributed random number
-		double x1 = ranUni(); // get two uniformly distributed values
-		double x2 = ranUni();
+		if (gauMethod == ZIGGURAT){
+			double y1 = ranGauZig();
+			return std::make_pair(y1, ranGauZig());
+		}
+		double x1 = gauUni(); // get two uniformly distributed values
+		double x2 = gauUni();
 		// use Box-Muller transform
-		return std::make_pair(std::sqrt(-2 * std::log(x1)) * std::cos(2 * M_PI * x2), std::sqrt(-2 * std::log(x1)) * std::sin(2 * M_PI * x2));
+		return boxMuller(x1, x2);
+	}
+
+	/* Fill out[0..n) with Gaussian-distributed random numbers: out[2i] and out[2i + 1] are the
+	 * pair the i-th ranGau() call would return (the second value of the last pair is dropped
+	 * when n is odd). With BOX_MULLER, uniforms are drawn in blocks and transformed with the
+	 * branch-free polynomials of fast_math.h, which the compiler vectorizes; results differ
+	 * from ranGau() only by the few-ulp error documented there.
+	 */
+	void fillGau(double* out, size_t n){
+		if (gauMethod == ZIGGURAT){
+			for (size_t i = 0; i < n; i++)
+				out[i] = ranGauZig();
+			return;
+		}
+		const size_t BLOCK = 256; // Gaussian values per block
+		double u[BLOCK];
+		double r[BLOCK / 2], s[BLOCK / 2], c[BLOCK / 2];
+		for (size_t i = 0; i < n; i += BLOCK){
+			size_t pairs = (n - i < BLOCK ? n - i + 1 : BLOCK) / 2;
+			if (uniMode == UNI_LEGACY)
+				fillWith(u, 2 * pairs, toUni, false);
+			else
+				fillWith(u, 2 * pairs, toUniOpen, true);
+			for (size_t j = 0; j < pairs; j++){
+				r[j] = -2 * fastLog(u[2 * j]);
+				fastSinCos2Pi(u[2 * j + 1], s[j], c[j]);
+			}
+			sqrtArray(r, pairs);
+			for (size_t j = 0; j < pairs && i + 2 * j < n; j++){
+				out[i + 2 * j] = r[j] * c[j];
+				if (i + 2 * j + 1 < n)
+					out[i + 2 * j + 1] = r[j] * s[j];
+			}
+		}
+	}
+
+	/* Float versions of ranGau() and fillGau(): the Gaussian values are computed in double
+	 * and rounded to float, so the tails reach as far as in double (a float transform of
+	 * 24-bit uniforms would stop at 5.8 sigma) and only the storage is halved.
+	 */
+	std::pair<float, float> ranGauF(){
+		std::pair<double, double> rg = ranGau();
+		return std::make_pair(static_cast<float>(rg.first), static_cast<float>(rg.second));
 	}
 
-	int ranBin() {return ranUni() >= 0.5 ? 1 : 0;} // return the next binomial-distributed random number 0 or 1
+	void fillGauF(float* out, size_t n){ // fill out[0..n) with fillGau()'s values rounded to float
+		const size_t BLOCK = 256;
+		double g[BLOCK];
+		for (size_t i = 0; i < n; i += BLOCK){
+			size_t m = n - i < BLOCK ? n - i : BLOCK;
+			fillGau(g, m);
+			for (size_t j = 0; j < m; j++)
+				out[i + j] = static_cast<float>(g[j]);
+		}
+	}
+
+	/* Return the next k (1 <= k <= 32) random bits as an integer in [0, 2^k).
+	 * Bits come from a reservoir refilled with the low 32 bits of nextU64(), i.e. the middle
+	 * 32 bits of the square (the high 32 bits of nextU64() are the low bits of the square,
+	 * whose bit 1 is always 0 in the original mode). One step of the generator thus
+	 * serves 32 coin flips, or 16 two-bit direction picks.
+	 */
+	uint32_t ranBits(int k){
+		if (bitCnt < k){
+			bitBuf |= (nextU64() & 0xFFFFFFFF) << bitCnt;
+			bitCnt += 32;
+		}
+		uint32_t res = static_cast<uint32_t>(bitBuf & ((1ULL << k) - 1));
+		bitBuf >>= k;
+		bitCnt -= k;
+		return res;
+	}
+
+	/* Fill out with the next nbits random bits of the ranBits() stream, packed lowest bit
+	 * first: bit i is bit (i % 64) of out[i / 64]. Unused high bits of the last word are 0.
+	 */
+	void fillBin(uint64_t* out, size_t nbits){
+		size_t words = nbits / 64;
+		for (size_t i = 0; i < words; i++){
+			uint64_t lo = ranBits(32);
+			out[i] = lo | static_cast<uint64_t>(ranBits(32)) << 32;
+		}
+		int rest = nbits % 64;
+		if (rest){
+			uint64_t last = 0;
+			for (int b = 0; b < rest; b += 32)
+				last |= static_cast<uint64_t>(ranBits(rest - b < 32 ? rest - b : 32)) << b;
+			out[words] = last;
+		}
+	}
+
+	int ranBin() {return ranBits(1);} // return the next binomial-distributed random number 0 or 1
+
+	int ranBern(double p) {return uniOpen() < p ? 1 : 0;} // return 1 with probability p, otherwise 0
+
+	int ranBinom(const BinomialParams& bp){ // return the next Binomial(n, p)-distributed random number, O(1) expected time
+		int y = bp.inversion ? binomInversion(bp) : binomBTPE(bp);
+		return bp.p > 0.5 ? bp.n - y : y;
+	}
+
+	int ranBinom(int n, double p) {return ranBinom(BinomialParams(n, p));}
+
+	void fillBinom(int* out, size_t count, int n, double p){ // fill out[0..count) with Binomial(n, p)-distributed random numbers, set-up done once
+		BinomialParams bp(n, p);
+		for (size_t i = 0; i < count; i++)
+			out[i] = ranBinom(bp);
+	}
 };
 
+typedef BasicRandomNumber<MiddleSquareEngine> RandomNumber;
+
 
 
 #endif /* RANDOM_NUMBER_H_ */
@@ -0,0 +1,69 @@
+/*
+ * random_registry.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: fanchen
+ */
+
+#ifndef RANDOM_REGISTRY_H_
+#define RANDOM_REGISTRY_H_
+
+#include <cstddef> // size_t
+#include <cstdint> // uint64_t
+#include <ctime> // std::time() for seeding purpose
+#include <atomic>
+#include "random_number.h"
+
+/* Process-wide family of generators derived from one master seed.
+ * local() lazily gives each thread its own generator, substream 1 + i of the family
+ * RandomNumber(seed, 0), where i is the thread's index (0, 1, 2, ... in order of first
+ * touch). The first touch takes one atomic increment; after that local() is a plain
+ * thread_local access with no synchronization. Each generator sits in its own cache line,
+ * so threads drawing at full speed never share one.
+ * Thread indices follow the order in which threads first call local(), which can change
+ * from run to run. For results that must not depend on scheduling, key the generator on
+ * the work item instead: forTask(id) is substream id of the separate family
+ * RandomNumber(seed, 1), the same for a given seed and id whichever thread runs it.
+ * Substreams never overlap as long as each draws fewer than 2^40 numbers (see
+ * RandomNumber::stream()); thread indices and task ids must stay below 2^24.
+ */
+class RandomRegistry{
+private:
+	struct alignas(64) Slot{ // one thread's generator, alone in its cache line
+		RandomNumber rn;
+		size_t index;
+		explicit Slot(size_t i) : rn(RandomNumber(seedRef().load(std::memory_order_relaxed), 0).stream(1 + i)), index(i){}
+	};
+
+	static std::atomic<uint64_t>& seedRef(){ // the master seed, default is the time of first use
+		static std::atomic<uint64_t> seed(std::time(nullptr));
+		return seed;
+	}
+
+	static std::atomic<size_t>& threadCount(){ // number of thread indices handed out
+		static std::atomic<size_t> count(0);
+		return count;
+	}
+
+	static Slot& slot(){
+		thread_local Slot s(threadCount().fetch_add(1, std::memory_order_relaxed));
+		return s;
+	}
+
+public:
+	// Set the master seed. Threads that already called local() keep their generator, so call
+	// this before the workers start.
+	static void setSeed(uint64_t s) {seedRef().store(s, std::memory_order_relaxed);}
+	static uint64_t getSeed() {return seedRef().load(std::memory_order_relaxed);}
+
+	static RandomNumber& local() {return slot().rn;} // this thread's generator, created on first call
+	static size_t threadIndex() {return slot().index;} // this thread's index, 0 for the first thread to touch the registry
+
+	static RandomNumber forTask(uint64_t id){ // generator of work item id, independent of the thread running it
+		return RandomNumber(getSeed(), 1).stream(id);
+	}
+};
+
+
+
+#endif /* RANDOM_REGISTRY_H_ */
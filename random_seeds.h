@@ -0,0 +1,168 @@
+/*
+ * random_seeds.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: fanchen
+ */
+
+#ifndef RANDOM_SEEDS_H_
+#define RANDOM_SEEDS_H_
+
+#include <cstddef> // size_t
+#include <cstdint> // uint64_t
+#include <string>
+#include <vector>
+#include <fstream>
+#include <atomic>
+#include <thread>
+#include "random_number.h"
+
+/* Seed quality of the original (key 0) middle-square mode. Without a Weyl sequence the next
+ * state depends on the current one only, so every seed runs into a cycle after a tail: most
+ * 64-bit seeds only after billions of steps, but all seeds below 2^16 (and their negations)
+ * reach the fixed point 0 within three steps, and a few in ten thousand other seeds close a
+ * cycle within 2^16 steps. The Weyl mode has a period of 2^64 for every seed and needs none
+ * of this.
+ */
+
+struct CycleInfo{
+	bool found; // false if no cycle closed within the step limit
+	uint64_t tail; // steps before the cycle is entered
+	uint64_t period; // length of the cycle (1 for a fixed point)
+};
+
+inline uint64_t squareSwap(uint64_t x) {return MiddleSquareEngine(x)();} // next state of the original mode
+
+/* Brent's cycle detection on the states seed, squareSwap(seed), ... It takes about
+ * tail + 2 * period steps and no memory. If no cycle closes within limit steps, found is
+ * false and the seed is good for at least limit draws.
+ */
+inline CycleInfo findCycle(uint64_t seed, uint64_t limit = 1ULL << 32){
+	CycleInfo res = {false, 0, 0};
+	// find the period: the hare runs ahead in doubling blocks until it meets the tortoise
+	uint64_t power = 1, lam = 1, steps = 1;
+	uint64_t tortoise = seed, hare = squareSwap(seed);
+	while (tortoise != hare){
+		if (steps++ >= limit)
+			return res;
+		if (power == lam){
+			tortoise = hare;
+			power *= 2;
+			lam = 0;
+		}
+		hare = squareSwap(hare);
+		lam++;
+	}
+	// find the tail: start two walkers period steps apart, they meet where the cycle begins
+	tortoise = hare = seed;
+	for (uint64_t i = 0; i < lam; i++)
+		hare = squareSwap(hare);
+	uint64_t mu = 0;
+	while (tortoise != hare){
+		tortoise = squareSwap(tortoise);
+		hare = squareSwap(hare);
+		mu++;
+	}
+	res.found = true;
+	res.tail = mu;
+	res.period = lam;
+	return res;
+}
+
+/* Bitmap of the bad seeds in [first, first + count): seed s is bad if its sequence closes a
+ * cycle within limit steps. isBad() is one bit lookup; seeds outside the range are reported
+ * good. save() and load() use a compact binary file (a 32-byte header, then one bit per seed).
+ */
+class SeedTable{
+private:
+	uint64_t first, count, limit;
+	std::vector<uint64_t> bits; // bit i % 64 of bits[i / 64] is set if seed first + i is bad
+
+public:
+	SeedTable() : first(0), count(0), limit(0){}
+	SeedTable(uint64_t f, uint64_t n, uint64_t lim) : first(f), count(n), limit(lim), bits((n + 63) / 64){}
+
+	uint64_t getFirst() const {return first;}
+	uint64_t getCount() const {return count;}
+	uint64_t getLimit() const {return limit;}
+
+	bool isBad(uint64_t seed) const{
+		uint64_t i = seed - first;
+		return i < count && (bits[i / 64] >> (i % 64) & 1);
+	}
+
+	void setWord(uint64_t w, uint64_t badBits) {bits[w] = badBits;} // bad flags of seeds first + 64 * w to first + 64 * w + 63
+	size_t words() const {return bits.size();}
+
+	uint64_t badCount() const{
+		uint64_t n = 0;
+		for (size_t w = 0; w < bits.size(); w++)
+			n += __builtin_popcountll(bits[w]);
+		return n;
+	}
+
+	/* Return seed if it is not bad, otherwise mix64(seed + 1), repeated while the result is
+	 * still a bad seed of the table. Outside the table a mixed seed is a random 64-bit seed,
+	 * which closes a cycle within 2^16 steps with probability about 2^-33.
+	 */
+	uint64_t remap(uint64_t seed) const{
+		while (isBad(seed))
+			seed = mix64(seed + 1);
+		return seed;
+	}
+
+	bool save(const std::string& path) const{
+		std::ofstream out(path.c_str(), std::ios::binary);
+		putRaw(out, 0x5344454553515347ULL); // "GSQSEEDS"
+		putRaw(out, first);
+		putRaw(out, count);
+		putRaw(out, limit);
+		out.write(reinterpret_cast<const char*>(bits.data()), bits.size() * sizeof(uint64_t));
+		return static_cast<bool>(out);
+	}
+
+	bool load(const std::string& path){
+		std::ifstream in(path.c_str(), std::ios::binary);
+		uint64_t magic, f, n, lim;
+		if (!getRaw(in, magic) || magic != 0x5344454553515347ULL || !getRaw(in, f) || !getRaw(in, n) || !getRaw(in, lim))
+			return false;
+		std::vector<uint64_t> b((n + 63) / 64);
+		if (!in.read(reinterpret_cast<char*>(b.data()), b.size() * sizeof(uint64_t)))
+			return false;
+		first = f;
+		count = n;
+		limit = lim;
+		bits.swap(b);
+		return true;
+	}
+};
+
+/* Scan the seeds [first, first + count) on threads threads and mark those whose sequence
+ * closes a cycle within limit steps. Good seeds cost limit steps each (about 1.5 ns per step),
+ * bad ones usually far fewer, so threads take 64 seeds at a time from a shared counter.
+ */
+inline SeedTable scanSeeds(uint64_t first, uint64_t count, uint64_t limit = 1 << 16, unsigned threads = std::thread::hardware_concurrency()){
+	SeedTable table(first, count, limit);
+	std::atomic<uint64_t> nextWord(0);
+	std::vector<std::thread> workers;
+	for (unsigned t = 0; t < (threads ? threads : 1); t++)
+		workers.push_back(std::thread([&](){
+			for (uint64_t w = nextWord++; w < table.words(); w = nextWord++){
+				uint64_t badBits = 0;
+				for (uint64_t i = 0; i < 64 && 64 * w + i < count; i++)
+					if (findCycle(first + 64 * w + i, limit).found)
+						badBits |= 1ULL << i;
+				table.setWord(w, badBits);
+			}
+		}));
+	for (size_t t = 0; t < workers.size(); t++)
+		workers[t].join();
+	return table;
+}
+
+inline MiddleSquareEngine::MiddleSquareEngine(uint64_t seed, const SeedTable& table) :
+	curr(table.remap(seed)), weyl(0), key(0), base(curr), splits(0){}
+
+
+
+#endif /* RANDOM_SEEDS_H_ */
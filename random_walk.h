@@ -9,158 +9,739 @@
 #define RANDOM_WALK_H_
 
 #include <vector>
+#include <string>
+#include <fstream>
+#include <cstdio> // std::rename(), std::remove()
+#include <cstddef> // std::ptrdiff_t
+#include <iterator> // std::input_iterator_tag
+#include <utility> // std::pair<>
+#include <algorithm> // std::min(), std::max()
+#include <cmath> // std::fmod()
 #include "random_number.h"
+#include "random_distributions.h"
+#include "random_walk_targets.h"
 
-class RandomWalk{
+/* Step policies: the distribution of the step distances and of the random start, chosen at
+ * compile time by BasicRandomWalk's Step parameter, so that the step loop is inlined for it
+ * with no mode test. A policy provides
+ *   int mode() const                        0 uniform, 1 Gaussian, other values user-defined;
+ *                                           saved with the walker and passed back to load()
+ *   double operator()(Gen& rn)              a step distance in [0, 1]
+ *   double cdf(double t) const              P(distance <= t), for STEP_TRUNCATED
+ *   double truncated(Gen& rn, double reach) a distance conditioned on <= reach, for STEP_TRUNCATED
+ *   std::pair<double, double> start(Gen& rn, double maxX, double maxY, bool exact)
+ *                                           a random start on [-maxX, maxX] x [-maxY, maxY],
+ *                                           in bounded time if exact
+ *   void save(std::ostream&) const, bool load(std::istream&, int mode)
+ *                                           state kept between draws; load() returns false if
+ *                                           it cannot continue a walker saved with mode
+ * A user policy can derive from UniformStep and replace the distance members. DynamicStep
+ * picks uniform or Gaussian at run time and is the policy of RandomWalk.
+ */
+class UniformStep{
+public:
+	int mode() const {return 0;}
+
+	template<class Gen>
+	double operator()(Gen& rn) {return rn.ranUni();}
+
+	double cdf(double t) const {return t;}
+
+	template<class Gen>
+	double truncated(Gen& rn, double reach) {return rn.ranUni() * reach;}
+
+	template<class Gen>
+	std::pair<double, double> start(Gen& rn, double maxX, double maxY, bool){ // uniform on the map
+		double x = rn.ranUni() * (2 * maxX) - maxX;
+		double y = rn.ranUni() * (2 * maxY) - maxY;
+		return std::make_pair(x, y);
+	}
+
+	void save(std::ostream&) const{}
+	bool load(std::istream&, int m) {return m == 0;}
+};
+
+class GaussianStep{
+private:
+	TruncGaussianDist dist; // a standard normal on [-1, 1], keeping the values it did not use
+public:
+	GaussianStep() : dist(-1.0, 1.0){}
+
+	int mode() const {return 1;}
+
+	template<class Gen>
+	double operator()(Gen& rn) {return std::abs(dist(rn));} // the first Gaussian rv that has abs value between 0 and 1
+
+	// the absolute value of a standard normal conditioned on being at most 1
+	double cdf(double t) const {return std::erf(t * M_SQRT1_2) / std::erf(M_SQRT1_2);}
+
+	template<class Gen>
+	double truncated(Gen& rn, double reach) {return rn.ranTruncGau(0.0, reach);}
+
+	template<class Gen>
+	std::pair<double, double> start(Gen& rn, double maxX, double maxY, bool exact){
+		if (exact){ // the normal truncated to the map
+			double x = rn.ranTruncGau(-maxX, maxX);
+			double y = rn.ranTruncGau(-maxY, maxY);
+			return std::make_pair(x, y);
+		}
+		while(true){
+			std::pair<double, double> rv = rn.ranGau();
+			if (std::abs(rv.first) < maxX && std::abs(rv.second) < maxY) // choose the first Gaussian rv pair that are within the map boundary
+				return rv;
+		}
+	}
+
+	void save(std::ostream& out) const {dist.save(out);}
+	bool load(std::istream& in, int m) {return m == 1 && dist.load(in);}
+};
+
+class DynamicStep{
+private:
+	int m; // 0 = uniform, 1 = Gaussian
+	UniformStep uni;
+	GaussianStep gau;
+public:
+	DynamicStep(int mode) : m(mode){ // the mode argument of RandomWalk(int m, ...)
+		if (m != 0 && m != 1){
+			std::cerr << "Error in RandomWalk.mode" << std::endl;
+			exit(1);
+		}
+	}
+
+	int mode() const {return m;}
+
+	template<class Gen>
+	double operator()(Gen& rn) {return m ? gau(rn) : uni(rn);}
+
+	double cdf(double t) const {return m ? gau.cdf(t) : uni.cdf(t);}
+
+	template<class Gen>
+	double truncated(Gen& rn, double reach) {return m ? gau.truncated(rn, reach) : uni.truncated(rn, reach);}
+
+	template<class Gen>
+	std::pair<double, double> start(Gen& rn, double maxX, double maxY, bool exact){
+		return m ? gau.start(rn, maxX, maxY, exact) : uni.start(rn, maxX, maxY, exact);
+	}
+
+	void save(std::ostream& out) const{
+		if (m)
+			gau.save(out);
+	}
+
+	bool load(std::istream& in, int mode){
+		GaussianStep g(gau);
+		if ((mode != 0 && mode != 1) || (mode == 1 && !g.load(in, mode)))
+			return false;
+		m = mode;
+		gau = g;
+		return true;
+	}
+};
+
+/* Boundary policies: what a step does at the edge of the map, chosen at compile time by
+ * BasicRandomWalk's Boundary parameter. apply(c, lo, hi) takes the coordinate c a step has
+ * just moved and returns whether the walker is still on the map [lo, hi]. With REDRAW, a
+ * false means the step is drawn again; otherwise it moves c back onto the map and the walk
+ * goes on, or ends there if false. Apart from RejectBoundary, every step draws one distance
+ * and one direction, so the cost per step does not depend on the walls and setStepSampler()
+ * has no effect. RandomWalkLanes has masked versions of the same operations.
+ * sweep(c, end, lo, hi, piece) calls piece(a, b) for the straight pieces, in order, of the
+ * path a step from c to end (before apply()) travels on the map, until one returns true, and
+ * returns whether one did; the walker tests them against its destination regions. ID
+ * tells the policies apart in save(), so that a walker only loads the walks of its own kind.
+ */
+struct RejectBoundary{ // the original rule: a step that would leave the map is drawn again, see setStepSampler()
+	static const bool REDRAW = true;
+	static const int ID = 0;
+
+	template<class Real>
+	static bool apply(Real& c, Real lo, Real hi) {return !(c > hi || c < lo);}
+
+	template<class Real, class Piece>
+	static bool sweep(Real c, Real end, Real, Real, Piece piece) {return piece(c, end);} // only accepted steps are swept
+};
+
+struct ReflectBoundary{ // the part of a step beyond a wall is mirrored back from it
+	static const bool REDRAW = false;
+	static const int ID = 1;
+
+	template<class Real>
+	static bool apply(Real& c, Real lo, Real hi){
+		if (!(lo < hi)){ // a map of zero width, e.g. setDim(0, h): lo is the only place on it
+			c = lo;
+			return true;
+		}
+		do{ // min() and max() mirror at hi and lo only where c is beyond them
+			c = std::min(c, 2 * hi - c);
+			c = std::max(c, 2 * lo - c);
+		} while (c > hi); // again only for steps longer than the map is wide
+		return true;
+	}
+
+	template<class Real, class Piece>
+	static bool sweep(Real c, Real end, Real lo, Real hi, Piece piece){
+		if (!(lo < hi))
+			return piece(c, lo);
+		while (end > hi || end < lo){ // to the wall, then on from it with the rest mirrored, as in apply()
+			Real wall = end > hi ? hi : lo;
+			if (piece(c, wall))
+				return true;
+			c = wall;
+			end = 2 * wall - end;
+		}
+		return piece(c, end);
+	}
+};
+
+struct PeriodicBoundary{ // the map is a torus: a step leaving at one wall comes back in at the opposite one
+	static const bool REDRAW = false;
+	static const int ID = 2;
+
+	template<class Real>
+	static bool apply(Real& c, Real lo, Real hi){
+		Real w = hi - lo;
+		c += w * ((c < lo) - (c > hi)); // one wrap, the only one needed when the map is at least a step wide
+		if (c < lo || c > hi){
+			if (!(lo < hi)) // a map of zero width: lo is the only place on it
+				c = lo;
+			else{ // a step longer than the map is wide
+				c = std::fmod(c - lo, w);
+				c = lo + (c < 0 ? c + w : c);
+			}
+		}
+		return true;
+	}
+
+	template<class Real, class Piece>
+	static bool sweep(Real c, Real end, Real lo, Real hi, Piece piece){
+		Real w = hi - lo;
+		if (end > hi) // to the wall, then on from the opposite one; all of [lo, hi] after more than one wrap
+			return piece(c, hi) || piece(lo, std::min(end - w, hi));
+		if (end < lo)
+			return piece(c, lo) || piece(hi, std::max(end + w, lo));
+		return piece(c, end);
+	}
+};
+
+struct AbsorbBoundary{ // a walker reaching a wall stops on it and its walk ends
+	static const bool REDRAW = false;
+	static const int ID = 3;
+
+	template<class Real>
+	static bool apply(Real& c, Real lo, Real hi){
+		bool inside = !(c > hi || c < lo);
+		c = std::min(std::max(c, lo), hi);
+		return inside;
+	}
+
+	template<class Real, class Piece>
+	static bool sweep(Real c, Real end, Real lo, Real hi, Piece piece) {return piece(c, std::min(std::max(end, lo), hi));}
+};
+
+template<class Real>
+struct WalkTrajectory{ // positions of a walk as a struct of arrays, reusable across walks
+	std::vector<Real> x; // x[0..n) and y[0..n) are the points of the last walk; the arrays only grow,
+	std::vector<Real> y; // so a walk into them costs its own steps, not a refill of the rest
+	int n;
+
+	WalkTrajectory() : n(0){}
+
+	void fit(int points){ // make room for points positions
+		if (x.size() < static_cast<size_t>(points)){
+			x.resize(points);
+			y.resize(points);
+		}
+	}
+};
+
+/* Random walk whose coordinates are stored and updated as Real. RandomWalk uses double;
+ * RandomWalkF uses float, which halves the trajectory memory and the bandwidth to store it.
+ * Both draw the same random numbers for the same seed (step distances are drawn in double
+ * and rounded), so a float walk follows the double walk until a rounding difference flips
+ * a boundary or destination check.
+ * Accuracy at float precision: positions carry 24 significant bits, so a coordinate of
+ * magnitude |x| is rounded by up to 2^-24 * |x| on every step (6e-8 at |x| = 1). The map
+ * bounds are rounded to float too and compared exactly, so every stored point is inside
+ * them. The destination test uses a margin of 1e-5, which a float position can only meet
+ * where its spacing 2^-23 * |x| is below 2e-5, i.e. for destinations with |x|, |y| < 160;
+ * farther out, or for walks that must match a double walk step for step, use double.
+ * Step is the step policy; UniformWalk and GaussianWalk fix the mode at compile time and walk
+ * exactly as RandomWalk(0, seed) and RandomWalk(1, seed). Boundary is the boundary policy,
+ * RejectBoundary by default.
+ * The destination is a point, reached by landing within 1e-5 of it, or a DestinationSet of
+ * disks and rectangles, reached by any step that touches one on its way (see setDes()).
+ */
+enum StepSampler {STEP_REJECTION, STEP_TRUNCATED}; // how a step that would leave the map is avoided, see setStepSampler()
+
+template<class Real = double, class Step = DynamicStep, class Boundary = RejectBoundary>
+class BasicRandomWalk{
 private:
-	int mode; // mode = 0, Use uniform distribution; mode = 1, Use Gaussian distribution
+	Step step; // distribution of the step distances and the random start
+	StepSampler sampler;
 	// horizontal reach
-	double maxX;
-	double minX;
+	Real maxX;
+	Real minX;
 	// vertical reach
-	double maxY;
-	double minY;
+	Real maxY;
+	Real minY;
 
-	double mapW; // map width
-	double mapH; // map height
+	Real mapW; // map width
+	Real mapH; // map height
 
 	// destination coordinates
-	double desX;
-	double desY;
+	Real desX;
+	Real desY;
+	const DestinationSet* targets; // destination regions instead of (desX, desY), if not null
 
 	// starting point coordinates
-	double staX;
-	double staY;
+	Real staX;
+	Real staY;
+	bool repick; // setDim() left the start off the map: pick a new one before the next walk
 
 	RandomNumber rn;
 
-	bool inBoundary(double x, double y){ // check whether the location is within or out of bound
+	friend class RandomWalkLanes; // walks RandomWalk instances in SIMD lanes
+
+	static const uint64_t CHECKPOINT_MAGIC = 0x544E504B434B4C57ULL; // "WLKCKPNT", first 8 bytes of a walk checkpoint
+
+	bool inBoundary(Real x, Real y){ // check whether the location is within or out of bound
 		return (x > maxX || x < minX || y > maxY || y < minY) ? false : true;
 	}
 
-	bool reachDest(double x, double y){ // check whether random walk has reached the destination
-		double error = 0.00001; // arbitrary error margin
+	bool reachDest(Real x, Real y){ // check whether random walk has reached the destination
+		Real error = 0.00001; // arbitrary error margin
 		return (std::abs(x - desX) >= error || std::abs(y - desY) >= error) ? false : true;
 	}
 
-	void randomPickStart(){
-		switch(mode){
-		case 0: // use Uniform distribution
-			staX = (rn.ranUni()) * mapW - maxX; // make sure minX <= sx <= maxX
-			staY = (rn.ranUni()) * mapH - maxY; // make sure minY <= sy <= maxY
-			break;
-		case 1: // use Gaussain distribution
-			while(true){
-				std::pair<double, double> rv = rn.ranGau();
-				if (std::abs(rv.first) < maxX && std::abs(rv.second) < maxY){ // choose the first Gaussian rv pair that are within the map boundary
-					staX = rv.first;
-					staY = rv.second;
-					break;
-				}
-			}
-			break;
-		default:
-			std::cerr << "Error in RandomWalk.mode" << std::endl;
-			exit(1);
+	/* Whether a step along x (alongX) or y, the other coordinate being o, that went from
+	 * coordinate from towards end (before Boundary::apply()) touches a destination region on its
+	 * way; if it does, the walker stops there: c, the coordinate it moved, is set to that point.
+	 */
+	bool sweepTargets(bool alongX, Real o, Real from, Real end, Real lo, Real hi, Real& c){
+		const DestinationSet& t = *targets;
+		double at;
+		if (!Boundary::sweep(from, end, lo, hi, [&t, alongX, o, &at](Real a, Real b){return t.sweep(alongX, o, a, b, at);}))
+			return false;
+		c = static_cast<Real>(at);
+		return true;
+	}
+
+	void randomPickStart(bool exact = false){ // exact: draw the Gaussian start from the normal truncated to the map, in bounded time
+		std::pair<double, double> st = step.start(rn, maxX, maxY, exact);
+		staX = static_cast<Real>(st.first); // make sure minX <= sx <= maxX
+		staY = static_cast<Real>(st.second); // make sure minY <= sy <= maxY
+	}
+
+	void settleStart(){ // called by every walk before it reads the start, so that setters never draw
+		if (repick && !inBoundary(staX, staY))
+			randomPickStart(true);
+		repick = false;
+	}
+
+	/* One step drawn directly from the distribution the rejection loop samples: the four
+	 * directions are weighted by the probability that a distance drawn for them stays on the
+	 * map, P(d <= room), and the distance is drawn from its distribution truncated to
+	 * [0, room] by inversion (ranTruncGau() for Gaussian steps). Two uniforms per step, whatever the
+	 * position and map size.
+	 */
+	bool stepTruncated(Real& x, Real& y){
+		const Real x0 = x, y0 = y;
+		const double room[4] = {maxX - x, x - minX, maxY - y, y - minY}; // right, left, up, down
+		double mass[4], total = 0;
+		for (int k = 0; k < 4; k++){
+			mass[k] = room[k] > 0 ? step.cdf(std::min(room[k], 1.0)) : 0.0;
+			total += mass[k];
+		}
+		double u = rn.ranUni() * total;
+		int k = 0;
+		while (k < 3 && u >= mass[k])
+			u -= mass[k++];
+		while (k > 0 && mass[k] == 0) // rounding left u beyond the last direction with mass
+			k--;
+		double reach = std::min(std::max(room[k], 0.0), 1.0);
+		double d = step.truncated(rn, reach);
+		switch (k){ // clamp, so that rounding cannot leave the map
+		case 0: x = std::min(static_cast<Real>(x + d), maxX); break;
+		case 1: x = std::max(static_cast<Real>(x - d), minX); break;
+		case 2: y = std::min(static_cast<Real>(y + d), maxY); break;
+		default: y = std::max(static_cast<Real>(y - d), minY);
+		}
+		if (targets)
+			return k < 2 ? sweepTargets(true, y, x0, x, minX, maxX, x) : sweepTargets(false, x, y0, y, minY, maxY, y);
+		return reachDest(x, y);
+	}
+
+	bool stepBounded(Real& x, Real& y){ // one step under a Boundary without REDRAW: the draws of one rejection attempt, then Boundary::apply()
+		Real d = static_cast<Real>(step(rn));
+		uint32_t bits = rn.ranBits(2);
+		Real move = (bits & 2) ? d : -d;
+		bool alongX = bits & 1;
+		Real& c = alongX ? x : y;
+		Real lo = alongX ? minX : minY, hi = alongX ? maxX : maxY;
+		Real from = c;
+		c += move;
+		bool inside = Boundary::apply(c, lo, hi);
+		if (targets)
+			return sweepTargets(alongX, alongX ? y : x, from, from + move, lo, hi, c) || !inside;
+		return !inside || reachDest(x, y);
+	}
+
+	bool stepFrom(Real& x, Real& y){ // take one step from (x, y), return true if the new position reaches the destination (or the walk ends at the boundary)
+		if (!Boundary::REDRAW)
+			return stepBounded(x, y);
+		if (sampler == STEP_TRUNCATED)
+			return stepTruncated(x, y);
+		Real newX, newY;
+		int xORy; // 1 = in x direction, 0 = in y direction
+
+		while (true){ // find next position
+			newX = x;
+			newY = y;
+			Real d = static_cast<Real>(step(rn)); // get next step's distance
+
+			// determine walking direction, both picks from one 2-bit draw
+			uint32_t bits = rn.ranBits(2);
+			xORy = bits & 1;
+			int dir = (bits & 2) ? 1 : -1; // 1 = go right or up, -1 = go left or down
+
+			// find next coordinates of next position
+			if (xORy) // in x direction
+				newX += d * dir;
+			else // in y direction
+				newY += d * dir;
+
+			if (inBoundary(newX, newY)) // new position within boundary
+				break;
+			// else if new positions out of boundary, try again
+		}
+		Real fromX = x, fromY = y;
+		x = newX;
+		y = newY;
+		if (targets)
+			return xORy ? sweepTargets(true, y, fromX, x, minX, maxX, x) : sweepTargets(false, x, fromY, y, minY, maxY, y);
+		return reachDest(newX, newY);
+	}
+
+	/* Take steps from to to, starting at (x, y), and hand every new position to store(x, y);
+	 * return true if the destination was reached. All walk() overloads run this loop, and the
+	 * lazy walk runs stepFrom() itself, so they produce the same positions for the same
+	 * generator state.
+	 */
+	template<class Store>
+	bool walkSteps(Real x, Real y, int from, int to, Store store){
+		for (int i = from; i < to; i++){
+			bool arrived = stepFrom(x, y);
+			store(x, y);
+			if (arrived) // if the new position reaches destination, end walk
+				return true;
+		}
+		return false;
+	}
+
+	bool walkSteps(std::vector<std::vector<Real> >& res, int from, int to){ // continue the walk in res, appending to res[0] and res[1]
+		return walkSteps(res[0].back(), res[1].back(), from, to, [&res](Real x, Real y){
+			res[0].push_back(x);
+			res[1].push_back(y);
+		});
+	}
+
+	// Append the positions not yet in the points file, then replace the state file, so that a
+	// run killed at any moment leaves a consistent checkpoint behind.
+	bool checkpoint(const std::string& path, std::fstream& points, const std::vector<std::vector<Real> >& res, size_t& written, int done, bool finished){
+		points.seekp(written * 2 * sizeof(Real));
+		for (size_t k = written; k < res[0].size(); k++){
+			putRaw(points, res[0][k]);
+			putRaw(points, res[1][k]);
 		}
+		points.flush();
+		if (!points)
+			return false;
+		written = res[0].size();
+
+		std::string tmp = path + ".tmp";
+		std::ofstream out(tmp.c_str(), std::ios::binary);
+		uint64_t magic = CHECKPOINT_MAGIC, steps = done, n = written;
+		putRaw(out, magic);
+		save(out);
+		putRaw(out, steps);
+		putRaw(out, static_cast<uint8_t>(finished));
+		putRaw(out, n);
+		out.close();
+		if (!out)
+			return false;
+		if (std::rename(tmp.c_str(), path.c_str()) != 0){ // rename() does not replace an existing file everywhere
+			std::remove(path.c_str());
+			return std::rename(tmp.c_str(), path.c_str()) == 0;
+		}
+		return true;
 	}
 
-	double getDistance(){
-		// determine step size for x and y direction
-		double d;
-		switch(mode){
-		case 0: // use Uniform distribution
-			d = rn.ranUni();
-			break;
-		case 1: // use Gaussain distribution
-			while(true){
-				std::pair<double, double> rv = rn.ranGau();
-				// choose one Gaussian rv that has abs value between 0 and 1
-				if (std::abs(rv.first) <= 1){
-					d = std::abs(rv.first);
-					break;
-				}
-				else if (std::abs(rv.second) <= 1){
-					d = std::abs(rv.second);
-					break;
-				}
-				// else, neither rv values meet the requirement, try again
+	bool resume(const std::string& path, std::vector<std::vector<Real> >& res, int& done, bool& finished){ // load the checkpoint at path, if there is a valid one
+		std::ifstream in(path.c_str(), std::ios::binary);
+		if (!in)
+			return false;
+		BasicRandomWalk w(*this);
+		uint64_t magic, steps, n;
+		uint8_t fin;
+		if (!getRaw(in, magic) || magic != CHECKPOINT_MAGIC || !w.load(in) || !getRaw(in, steps) || !getRaw(in, fin) || !getRaw(in, n)){
+			std::cerr << "Error reading checkpoint " << path << ", starting a new walk" << std::endl;
+			return false;
+		}
+		std::ifstream pin((path + ".points").c_str(), std::ios::binary);
+		std::vector<std::vector<Real> > r(2, std::vector<Real>(n));
+		for (uint64_t k = 0; k < n; k++){
+			if (!getRaw(pin, r[0][k]) || !getRaw(pin, r[1][k])){
+				std::cerr << "Error reading checkpoint " << path << ".points, starting a new walk" << std::endl;
+				return false;
 			}
-			break;
-		default:
-			std::cerr << "Error in RandomWalk.mode" << std::endl;
-			exit(1);
 		}
-		return d;
+		*this = w;
+		res.swap(r);
+		done = static_cast<int>(steps);
+		finished = fin != 0;
+		return true;
 	}
 
 
 public:
-	RandomWalk(int m, uint64_t seed = std::time(nullptr)) :
-		mode(m),
+	BasicRandomWalk(const Step& s, uint64_t seed = std::time(nullptr)) :
+		step(s), sampler(STEP_REJECTION),
 		maxX(2.0), minX(-2.0),
 		maxY(2.0), minY(-2.0),
 		mapW(4.0), mapH(4.0),
-		desX(0.0), desY(0.0), rn(seed){randomPickStart();} // constructor.
+		desX(0.0), desY(0.0), targets(nullptr), repick(false), rn(seed){randomPickStart();} // constructor, RandomWalk(m, seed) with mode m = 0 or 1, or e.g. GaussianWalk(GaussianStep(), seed).
 	//The map default will be centered on (0, 0) with width and height being 4.
 	// Default destination is (0, 0); default starting point is randomly selected
 
-	std::vector<std::vector<double> > walk(int steps = 100){ // default randwom walk 100 steps
-		std::vector<std::vector<double> > res; // an array of two arrays, res[0] for x coordinates, res[1] for y coordinates.
-		res.emplace_back(std::vector<double>());
-		res.emplace_back(std::vector<double>());
+	BasicRandomWalk(const Step& s, const RandomNumber& gen) :
+		step(s), sampler(STEP_REJECTION),
+		maxX(2.0), minX(-2.0),
+		maxY(2.0), minY(-2.0),
+		mapW(4.0), mapH(4.0),
+		desX(0.0), desY(0.0), targets(nullptr), repick(false), rn(gen){randomPickStart();} // constructor drawing from a given generator, e.g. a substream or RandomRegistry::forTask(id)
+
+	std::vector<std::vector<Real> > walk(int steps = 100){ // default randwom walk 100 steps
+		std::vector<std::vector<Real> > res(2); // an array of two arrays, res[0] for x coordinates, res[1] for y coordinates.
+		settleStart();
 
 		// push starting positions to res
 		res[0].push_back(staX);
 		res[1].push_back(staY);
 
-		for (int i = 0; i < steps; i++){
-			double newX, newY;
-
-			while (true){ // find next position
-				newX = *res[0].rbegin();
-				newY = *res[1].rbegin();
-				double d = getDistance(); // get next step's distance
-
-				// determine walking direction
-				int xORy = rn.ranBin(); // 1 = in x direction, 0 = in y direction
-				int dir = rn.ranBin() ? 1 : -1; // 1 = go right or up, -1 = go left or down
-
-				// find next coordinates of next position
-				if (xORy) // in x direction
-					newX += d * dir;
-				else // in y direction
-					newY += d * dir;
-
-				if (inBoundary(newX, newY)){ // new position within boundary, push them to res
-					res[0].push_back(newX);
-					res[1].push_back(newY);
-					break;
-				}
-				// else if new positions out of boundary, try again
+		walkSteps(res, 0, steps);
+		return res;
+	}
+
+	/* walk(steps) into caller-provided arrays: the starting point goes to xs[0], ys[0] and the
+	 * positions after it to the following entries. Both arrays must hold steps + 1 values.
+	 * Return the number of points written, less than steps + 1 if the destination was reached.
+	 * Nothing is allocated.
+	 */
+	int walk(int steps, Real* xs, Real* ys){
+		settleStart();
+		xs[0] = staX;
+		ys[0] = staY;
+		int n = 1;
+		walkSteps(staX, staY, 0, steps, [xs, ys, &n](Real x, Real y){
+			xs[n] = x;
+			ys[n] = y;
+			n++;
+		});
+		return n;
+	}
+
+	typedef WalkTrajectory<Real> Trajectory; // positions of a walk as a struct of arrays, shared by the walkers of every step policy
+
+	// walk(steps) into t, whose t.n is set to the points of the walk. The arrays are only
+	// grown, when they hold fewer than steps + 1 points, so reusing one Trajectory for many
+	// walks of the same length allocates and fills memory once.
+	int walk(int steps, Trajectory& t){
+		t.fit(steps + 1);
+		t.n = walk(steps, t.x.data(), t.y.data());
+		return t.n;
+	}
+
+	/* Input iterator over the positions of a lazy walk (see lazyWalk()). Dereferencing gives
+	 * the current position; incrementing takes the next step, or turns the iterator into the
+	 * end iterator once the walk has taken its steps or reached the destination.
+	 */
+	class StepIterator{
+	private:
+		BasicRandomWalk* rw; // null for the end iterator
+		std::pair<Real, Real> pos;
+		int left; // steps still to take
+		bool arrived; // pos reaches the destination
+	public:
+		typedef std::input_iterator_tag iterator_category;
+		typedef std::pair<Real, Real> value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef const value_type* pointer;
+		typedef const value_type& reference;
+
+		StepIterator() : rw(nullptr), pos(), left(0), arrived(false){} // the end iterator
+		StepIterator(BasicRandomWalk* w, int steps) : rw(w), pos(w->staX, w->staY), left(steps), arrived(false){}
+
+		reference operator*() const {return pos;}
+		pointer operator->() const {return &pos;}
+
+		StepIterator& operator++(){
+			if (left == 0 || arrived)
+				rw = nullptr;
+			else{
+				arrived = rw->stepFrom(pos.first, pos.second);
+				left--;
 			}
-			if (reachDest(newX, newY)) // if the new position reaches destination, end walk
-				break;
+			return *this;
+		}
+		StepIterator operator++(int) {StepIterator it(*this); ++*this; return it;}
+
+		bool operator==(const StepIterator& o) const {return rw == o.rw;}
+		bool operator!=(const StepIterator& o) const {return rw != o.rw;}
+	};
+
+	class StepRange{ // the range returned by lazyWalk()
+	private:
+		BasicRandomWalk* rw;
+		int steps;
+	public:
+		StepRange(BasicRandomWalk* w, int n) : rw(w), steps(n){}
+		StepIterator begin() const {return StepIterator(rw, steps);}
+		StepIterator end() const {return StepIterator();}
+	};
+
+	/* walk(steps) as a lazy range: the starting point, then one position per step, each taken
+	 * only when the iterator is incremented, in constant memory. It yields the same points as
+	 * walk(steps) and ends after the position that reaches the destination. Every step draws
+	 * from this walker's generator, so the range can be iterated once.
+	 */
+	StepRange lazyWalk(int steps = 100) {settleStart(); return StepRange(this, steps);}
+
+	/* walk(steps) with a checkpoint every `every` steps, for runs too long to restart. The
+	 * walker state (including the generator) goes to the file path and the positions to
+	 * path + ".points", which only grows, so a checkpoint costs the positions taken since the
+	 * last one. If path holds a checkpoint, the walk resumes from it, replacing this walker's
+	 * settings with the saved ones, and returns exactly what an uninterrupted walk would have
+	 * returned; a finished walk is returned as it is. Delete both files to start a new walk.
+	 */
+	std::vector<std::vector<Real> > walk(int steps, const std::string& path, int every = 1 << 20){
+		std::vector<std::vector<Real> > res;
+		int done = 0;
+		bool finished = false;
+		std::fstream points;
+		bool resumed = resume(path, res, done, finished);
+		if (resumed)
+			points.open((path + ".points").c_str(), std::ios::in | std::ios::out | std::ios::binary);
+		else{
+			settleStart();
+			res.assign(2, std::vector<Real>());
+			res[0].push_back(staX);
+			res[1].push_back(staY);
+			points.open((path + ".points").c_str(), std::ios::out | std::ios::trunc | std::ios::binary);
+		}
+		size_t written = resumed ? res[0].size() : 0; // positions already in the points file
+		every = std::max(every, 1);
+		while (!finished && done < steps){
+			int next = steps - done > every ? done + every : steps;
+			finished = walkSteps(res, done, next);
+			done = next;
+			if (!checkpoint(path, points, res, written, done, finished))
+				std::cerr << "Error writing checkpoint " << path << std::endl;
 		}
 		return res;
 	}
 
+	/* Save the walker (mode, boundary policy, map, start, destination, generator state and the
+	 * state of the step policy) to out; load() restores it and returns false, leaving the walker
+	 * unchanged, if out was not written by a walker of the same Real type, a step policy of the
+	 * same mode and the same boundary policy.
+	 */
+	void save(std::ostream& out) const{
+		putRaw(out, static_cast<int32_t>(sizeof(Real)));
+		putRaw(out, static_cast<int32_t>(step.mode()));
+		putRaw(out, static_cast<int32_t>(Boundary::ID));
+		putRaw(out, static_cast<int32_t>(sampler));
+		const Real v[] = {maxX, minX, maxY, minY, mapW, mapH, desX, desY, staX, staY};
+		for (int i = 0; i < 10; i++)
+			putRaw(out, v[i]);
+		rn.save(out);
+		step.save(out);
+	}
+
+	bool load(std::istream& in){
+		int32_t size, m, bound, smp;
+		Real v[10];
+		RandomNumber r(rn);
+		Step st(step);
+		if (!getRaw(in, size) || size != sizeof(Real) || !getRaw(in, m) || !getRaw(in, bound) || bound != Boundary::ID || !getRaw(in, smp) || smp < STEP_REJECTION || smp > STEP_TRUNCATED)
+			return false;
+		for (int i = 0; i < 10; i++)
+			if (!getRaw(in, v[i]))
+				return false;
+		if (!r.load(in) || !st.load(in, m))
+			return false;
+		step = st;
+		sampler = static_cast<StepSampler>(smp);
+		maxX = v[0]; minX = v[1]; maxY = v[2]; minY = v[3]; mapW = v[4]; mapH = v[5];
+		desX = v[6]; desY = v[7]; staX = v[8]; staY = v[9];
+		repick = !inBoundary(staX, staY); // saved between setDim() and the walk that replaces the start
+		rn = r;
+		return true;
+	}
+
 	// getters
-	std::pair<double, double> getXRange(){return std::make_pair(minX, maxX);}
-	std::pair<double, double> getYRange(){return std::make_pair(minY, maxY);}
-	std::pair<double, double> getDes(){return std::make_pair(desX, desY);}
-	std::pair<double, double> getStart(){return std::make_pair(staX, staY);}
+	std::pair<Real, Real> getXRange(){return std::make_pair(minX, maxX);}
+	std::pair<Real, Real> getYRange(){return std::make_pair(minY, maxY);}
+	std::pair<Real, Real> getDes(){return std::make_pair(desX, desY);}
+	std::pair<Real, Real> getStart(){return std::make_pair(staX, staY);}
+	int getMode() const {return step.mode();} // 0 = uniform, 1 = Gaussian step distances
+	const DestinationSet* getTargets() const {return targets;} // the destination regions, null for a point destination
+	bool atDes(Real x, Real y){ // whether a walk at (x, y) has reached the destination
+		return targets ? targets->contains(x, y, 0.00001) : reachDest(x, y);
+	}
 
 	// setters
 	void setDim(double w, double h){ // set map's width and height.
 		mapW = w; mapH = h;
 		maxX = w / 2.0; minX = 0 - maxX;
 		maxY = h / 2.0; minY = 0 - maxY;
+		// The constructor picks the start on the default 4 x 4 map. If it is off the new map, no
+		// walk from it could ever be accepted, so the next walk picks a new one on this map
+		// unless setStart() gives one first. No draw is made here, so the order of the setters
+		// does not change the walk.
+		repick = !inBoundary(staX, staY);
 	}
-	void setStart(double x, double y) {staX = x; staY = y;} // set custom starting point
-	void setDes(double x, double y) {desX = x; desY = y;} // set custom destination point
+	void setStart(double x, double y) {staX = x; staY = y; repick = false;} // set custom starting point
+	void setDes(double x, double y) {desX = x; desY = y; targets = nullptr;} // set custom destination point
+
+	/* Make the regions of set the destination, in place of the point. Each step is tested
+	 * along the path it travels, reflections and wraps included, and a walker that touches a
+	 * region stops at the first point it touches, which ends the walk; one that starts in a
+	 * region stops at its first step. The walker keeps a pointer to set, which must outlive its
+	 * walks and is not part of save(); load() keeps the current one. Walkers with regions are
+	 * walked one at a time by RandomWalkLanes.
+	 */
+	void setDes(const DestinationSet& set) {targets = &set;}
+	void setDes(const DestinationSet&&) = delete; // a temporary would not outlive the walks
+	void setGauMethod(GauMethod m) {rn.setGauMethod(m);} // choose the algorithm for Gaussian-distributed step distances, default BOX_MULLER
+
+	/* Choose how steps that would leave the map are avoided. STEP_REJECTION (the default)
+	 * draws a new distance and direction until the step stays on the map, which keeps the
+	 * original sequence of every seed in mode 0 but needs many draws near a wall or on a map
+	 * smaller than the step distances. STEP_TRUNCATED samples the same conditional
+	 * distribution directly with two uniforms per step (a different sequence for the same seed).
+	 */
+	void setStepSampler(StepSampler s) {sampler = s;}
 };
 
+typedef BasicRandomWalk<double> RandomWalk;
+typedef BasicRandomWalk<float> RandomWalkF;
+typedef BasicRandomWalk<double, UniformStep> UniformWalk; // mode fixed at compile time, same walks as RandomWalk(0, seed)
+typedef BasicRandomWalk<double, GaussianStep> GaussianWalk; // same walks as RandomWalk(1, seed)
+typedef BasicRandomWalk<double, DynamicStep, ReflectBoundary> ReflectingWalk; // RandomWalk(m, seed) with reflecting walls
+typedef BasicRandomWalk<double, DynamicStep, PeriodicBoundary> PeriodicWalk; // on a torus
+typedef BasicRandomWalk<double, DynamicStep, AbsorbBoundary> AbsorbingWalk; // ending at the first wall it reaches
+
 
 
 #endif /* RANDOM_WALK_H_ */
@@ -0,0 +1,537 @@
+/*
+ * random_walk_lanes.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: fanchen
+ */
+
+#ifndef RANDOM_WALK_LANES_H_
+#define RANDOM_WALK_LANES_H_
+
+#include <cstddef> // size_t
+#include <cstdint> // uint64_t
+#include <type_traits> // std::is_same<>
+#include "random_walk.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define WALK_LANES_DISPATCH // AVX2 and AVX-512 kernels, chosen at run time
+#include <immintrin.h>
+#endif
+
+/* Walks many RandomWalk instances at once, one walker per SIMD lane: 8 lanes per instruction
+ * with AVX-512 (F and DQ), 2 x 4 with AVX2 and FMA, or a scalar loop over the lanes. The
+ * widest kernel the CPU supports is picked at run time, so no -m flag is needed.
+ * Every lane makes one step attempt per round, drawing exactly what walk() draws for it. A
+ * rejected move (out of bounds) is masked out and retried in the next round instead of in a
+ * per-walker loop, so a lane's random numbers, positions and final generator state are
+ * bit-identical to walk(steps) on the same walker. A lane whose walker has taken its steps
+ * or reached the destination is refilled with the next walker.
+ * Only uniform walks (mode 0) with the default UNI_LEGACY conversion and STEP_REJECTION are
+ * vectorized; Gaussian walks draw an unpredictable number of std::log() based pairs per step
+ * and are walked by walk() itself, with the same results, as are the other settings and
+ * walkers whose destination is a DestinationSet.
+ * Walkers with a reflecting, periodic or absorbing Boundary move in every round: the kernels
+ * apply the boundary to the moved coordinate with masked min/max, add and blend operations,
+ * and the rare steps longer than the map is wide, or any step across a map of zero width, are
+ * finished by Boundary::apply() itself.
+ */
+class RandomWalkLanes{
+private:
+	static const int L = 8;
+
+	// State of the walkers in the lanes, one array entry per lane
+	struct alignas(64) Lanes{
+		uint64_t curr[L], weyl[L], key[L]; // MiddleSquareEngine state
+		uint64_t bitBuf[L], bitCnt[L]; // ranBits() reservoir
+		int64_t left[L]; // steps still to take
+		double x[L], y[L]; // current position
+		double maxX[L], minX[L], maxY[L], minY[L], desX[L], desY[L];
+	};
+
+	static constexpr double DES_ERROR = 0.00001; // error margin of RandomWalk::reachDest()
+
+	// One step attempt of the active lanes. Returns the lanes that moved in bits 0-7 and, in
+	// bits 8-15, those of them that are done (no steps left, or at the destination).
+	typedef uint32_t (*Kernel)(Lanes&, uint32_t);
+
+	template<class Boundary>
+	static uint32_t attemptScalar(Lanes& s, uint32_t active){
+		uint32_t moved = 0;
+		for (int k = 0; k < L; k++){
+			if (!(active >> k & 1))
+				continue;
+			MiddleSquareEngine eng(s.curr[k]);
+			eng.weyl = s.weyl[k];
+			eng.key = s.key[k];
+			double d = toUni(eng());
+			if (s.bitCnt[k] < 2){
+				s.bitBuf[k] |= (eng() & 0xFFFFFFFF) << s.bitCnt[k];
+				s.bitCnt[k] += 32;
+			}
+			s.curr[k] = eng.curr;
+			s.weyl[k] = eng.weyl;
+			uint64_t bits = s.bitBuf[k] & 3;
+			s.bitBuf[k] >>= 2;
+			s.bitCnt[k] -= 2;
+
+			double nx = s.x[k], ny = s.y[k];
+			int dir = (bits & 2) ? 1 : -1;
+			bool inside;
+			if (bits & 1){
+				nx += d * dir;
+				inside = Boundary::REDRAW || Boundary::apply(nx, s.minX[k], s.maxX[k]);
+			}
+			else{
+				ny += d * dir;
+				inside = Boundary::REDRAW || Boundary::apply(ny, s.minY[k], s.maxY[k]);
+			}
+			if (Boundary::REDRAW && (nx > s.maxX[k] || nx < s.minX[k] || ny > s.maxY[k] || ny < s.minY[k]))
+				continue;
+			s.x[k] = nx;
+			s.y[k] = ny;
+			s.left[k]--;
+			moved |= 1u << k;
+			if (s.left[k] == 0 || !inside || !(std::abs(nx - s.desX[k]) >= DES_ERROR || std::abs(ny - s.desY[k]) >= DES_ERROR))
+				moved |= 1u << (k + L);
+		}
+		return moved;
+	}
+
+	// Finish the lanes of c whose coordinate the kernel's single reflection or wrap did not
+	// bring onto the map (a step longer than the map is wide, or a map of zero width): raw
+	// holds their coordinates before it, as Boundary::apply() takes them.
+	template<class Boundary>
+	static void boundRest(double* c, const double* raw, const double* lo, const double* hi, uint32_t lanes){
+		for (; lanes; lanes &= lanes - 1){
+			int k = __builtin_ctz(lanes);
+			c[k] = raw[k];
+			Boundary::apply(c[k], lo[k], hi[k]);
+		}
+	}
+
+#if defined(WALK_LANES_DISPATCH)
+	/* toUni() of 8 or 4 lanes: x % 10^15 from a floating-point quotient estimate, the middle
+	 * digits the same way, and the final division by 10^10 as a product with one FMA residual
+	 * correction, which is correctly rounded for all 10^10 inputs (see RandomNumberLanes).
+	 */
+	__attribute__((target("avx512f,avx512dq"))) static inline __m512d toUniAVX512(__m512i c){
+		const __m512i mod = _mm512_set1_epi64(1000000000000000LL);
+		__m512i q = _mm512_cvttpd_epu64(_mm512_mul_pd(_mm512_cvtepu64_pd(c), _mm512_set1_pd(1e-15)));
+		__m512i r = _mm512_sub_epi64(c, _mm512_mullo_epi64(q, mod));
+		r = _mm512_mask_add_epi64(r, _mm512_cmplt_epi64_mask(r, _mm512_setzero_si512()), r, mod);
+		r = _mm512_mask_sub_epi64(r, _mm512_cmpge_epi64_mask(r, mod), r, mod);
+
+		__m512d rd = _mm512_cvtepi64_pd(r);
+		const __m512d e5 = _mm512_set1_pd(100000.0);
+		const __m512d one = _mm512_set1_pd(1.0);
+		__m512d mid = _mm512_maskz_roundscale_pd(0xFF, _mm512_mul_pd(rd, _mm512_set1_pd(1e-5)), _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+		mid = _mm512_mask_sub_pd(mid, _mm512_cmp_pd_mask(_mm512_mul_pd(mid, e5), rd, _CMP_GT_OQ), mid, one);
+		mid = _mm512_mask_add_pd(mid, _mm512_cmp_pd_mask(_mm512_mul_pd(_mm512_add_pd(mid, one), e5), rd, _CMP_LE_OQ), mid, one);
+		__m512d u = _mm512_mul_pd(mid, _mm512_set1_pd(1e-10));
+		return _mm512_fmadd_pd(_mm512_fnmadd_pd(u, _mm512_set1_pd(10000000000.0), mid), _mm512_set1_pd(1e-10), u);
+	}
+
+	/* Boundary::apply() on the lanes m of the moved coordinates c, with the map [lo, hi] of each
+	 * lane. Return the lanes whose walk ends at the boundary. The operand order of min and max
+	 * matches std::min() and std::max(), so the results are bit-identical to apply().
+	 */
+	__attribute__((target("avx512f,avx512dq"))) static inline __mmask8 boundAVX512(RejectBoundary, __m512d&, __m512d, __m512d, __mmask8){return 0;} // not called, rejection is done by the kernel
+
+	__attribute__((target("avx512f,avx512dq"))) static inline __mmask8 boundAVX512(ReflectBoundary, __m512d& c, __m512d lo, __m512d hi, __mmask8 m){
+		alignas(64) double raw[L], r[L], l[L], h[L];
+		_mm512_store_pd(raw, c);
+		c = _mm512_mask_min_pd(c, m, _mm512_sub_pd(_mm512_add_pd(hi, hi), c), c);
+		c = _mm512_mask_max_pd(c, m, _mm512_sub_pd(_mm512_add_pd(lo, lo), c), c);
+		__mmask8 rest = _mm512_mask_cmp_pd_mask(m, c, hi, _CMP_GT_OQ);
+		if (rest){
+			_mm512_store_pd(r, c);
+			_mm512_store_pd(l, lo);
+			_mm512_store_pd(h, hi);
+			boundRest<ReflectBoundary>(r, raw, l, h, rest);
+			c = _mm512_load_pd(r);
+		}
+		return 0;
+	}
+
+	__attribute__((target("avx512f,avx512dq"))) static inline __mmask8 boundAVX512(PeriodicBoundary, __m512d& c, __m512d lo, __m512d hi, __mmask8 m){
+		alignas(64) double raw[L], r[L], l[L], h[L];
+		_mm512_store_pd(raw, c);
+		__m512d w = _mm512_sub_pd(hi, lo);
+		__mmask8 below = _mm512_mask_cmp_pd_mask(m, c, lo, _CMP_LT_OQ), above = _mm512_mask_cmp_pd_mask(m, c, hi, _CMP_GT_OQ);
+		c = _mm512_mask_sub_pd(c, above, c, w);
+		c = _mm512_mask_add_pd(c, below, c, w);
+		__mmask8 rest = _mm512_mask_cmp_pd_mask(m, c, lo, _CMP_LT_OQ) | _mm512_mask_cmp_pd_mask(m, c, hi, _CMP_GT_OQ);
+		if (rest){
+			_mm512_store_pd(r, c);
+			_mm512_store_pd(l, lo);
+			_mm512_store_pd(h, hi);
+			boundRest<PeriodicBoundary>(r, raw, l, h, rest);
+			c = _mm512_load_pd(r);
+		}
+		return 0;
+	}
+
+	__attribute__((target("avx512f,avx512dq"))) static inline __mmask8 boundAVX512(AbsorbBoundary, __m512d& c, __m512d lo, __m512d hi, __mmask8 m){
+		__mmask8 out = _mm512_mask_cmp_pd_mask(m, c, hi, _CMP_GT_OQ) | _mm512_mask_cmp_pd_mask(m, c, lo, _CMP_LT_OQ);
+		c = _mm512_mask_min_pd(c, m, hi, _mm512_mask_max_pd(c, m, lo, c));
+		return out;
+	}
+
+	template<class Boundary>
+	__attribute__((target("avx512f,avx512dq"))) static uint32_t attemptAVX512(Lanes& s, uint32_t active){
+		const __mmask8 m = static_cast<__mmask8>(active);
+		const __m512i key = _mm512_load_si512(s.key);
+		__m512i curr = _mm512_load_si512(s.curr);
+		__m512i weyl = _mm512_load_si512(s.weyl);
+
+		// step distance: one engine step and toUni(), as ranUni()
+		weyl = _mm512_mask_add_epi64(weyl, m, weyl, key);
+		curr = _mm512_mask_ror_epi64(curr, m, _mm512_add_epi64(_mm512_mullo_epi64(curr, curr), weyl), 32);
+		__m512d d = toUniAVX512(curr);
+
+		// direction: ranBits(2), refilling the reservoir with the low half of another step where it runs low
+		__m512i bitBuf = _mm512_load_si512(s.bitBuf);
+		__m512i bitCnt = _mm512_load_si512(s.bitCnt);
+		const __mmask8 refill = _mm512_mask_cmplt_epu64_mask(m, bitCnt, _mm512_set1_epi64(2));
+		weyl = _mm512_mask_add_epi64(weyl, refill, weyl, key);
+		curr = _mm512_mask_ror_epi64(curr, refill, _mm512_add_epi64(_mm512_mullo_epi64(curr, curr), weyl), 32);
+		bitBuf = _mm512_or_si512(bitBuf, _mm512_maskz_sllv_epi64(refill, _mm512_and_si512(curr, _mm512_set1_epi64(0xFFFFFFFF)), bitCnt));
+		bitCnt = _mm512_mask_add_epi64(bitCnt, refill, bitCnt, _mm512_set1_epi64(32));
+		const __mmask8 xAxis = _mm512_test_epi64_mask(bitBuf, _mm512_set1_epi64(1));
+		const __mmask8 up = _mm512_test_epi64_mask(bitBuf, _mm512_set1_epi64(2));
+		bitBuf = _mm512_mask_srli_epi64(bitBuf, m, bitBuf, 2);
+		bitCnt = _mm512_mask_sub_epi64(bitCnt, m, bitCnt, _mm512_set1_epi64(2));
+		_mm512_store_si512(s.curr, curr);
+		_mm512_store_si512(s.weyl, weyl);
+		_mm512_store_si512(s.bitBuf, bitBuf);
+		_mm512_store_si512(s.bitCnt, bitCnt);
+
+		// move, flipping the sign bit for left and down (d * -1 exactly, zeros included)
+		const __m512i sign = _mm512_set1_epi64(0x8000000000000000ULL);
+		__m512d step = _mm512_castsi512_pd(_mm512_mask_xor_epi64(_mm512_castpd_si512(d), static_cast<__mmask8>(~up), _mm512_castpd_si512(d), sign));
+		__m512d x = _mm512_load_pd(s.x), y = _mm512_load_pd(s.y);
+		__m512d nx = _mm512_mask_add_pd(x, xAxis, x, step);
+		__m512d ny = _mm512_mask_add_pd(y, static_cast<__mmask8>(~xAxis), y, step);
+
+		__mmask8 moved = m, ends = 0;
+		if (Boundary::REDRAW){ // accept the lanes whose new position is within bounds, written as !(out of bounds) as in inBoundary()
+			__mmask8 out = _mm512_cmp_pd_mask(nx, _mm512_load_pd(s.maxX), _CMP_GT_OQ) | _mm512_cmp_pd_mask(nx, _mm512_load_pd(s.minX), _CMP_LT_OQ)
+					| _mm512_cmp_pd_mask(ny, _mm512_load_pd(s.maxY), _CMP_GT_OQ) | _mm512_cmp_pd_mask(ny, _mm512_load_pd(s.minY), _CMP_LT_OQ);
+			moved = m & ~out;
+		}
+		else{ // every lane moves: apply the boundary to the moved coordinate
+			__m512d c = _mm512_mask_mov_pd(ny, xAxis, nx);
+			__m512d lo = _mm512_mask_mov_pd(_mm512_load_pd(s.minY), xAxis, _mm512_load_pd(s.minX));
+			__m512d hi = _mm512_mask_mov_pd(_mm512_load_pd(s.maxY), xAxis, _mm512_load_pd(s.maxX));
+			ends = boundAVX512(Boundary(), c, lo, hi, m);
+			nx = _mm512_mask_mov_pd(nx, xAxis, c);
+			ny = _mm512_mask_mov_pd(ny, static_cast<__mmask8>(~xAxis), c);
+		}
+		_mm512_store_pd(s.x, _mm512_mask_mov_pd(x, moved, nx));
+		_mm512_store_pd(s.y, _mm512_mask_mov_pd(y, moved, ny));
+		__m512i left = _mm512_load_si512(s.left);
+		left = _mm512_mask_sub_epi64(left, moved, left, _mm512_set1_epi64(1));
+		_mm512_store_si512(s.left, left);
+
+		// done: no steps left, or !(|x - desX| >= error || |y - desY| >= error) as in reachDest()
+		const __m512d err = _mm512_set1_pd(DES_ERROR);
+		__mmask8 far = _mm512_cmp_pd_mask(_mm512_abs_pd(_mm512_sub_pd(nx, _mm512_load_pd(s.desX))), err, _CMP_GE_OQ)
+				| _mm512_cmp_pd_mask(_mm512_abs_pd(_mm512_sub_pd(ny, _mm512_load_pd(s.desY))), err, _CMP_GE_OQ);
+		__mmask8 done = moved & (_mm512_cmpeq_epi64_mask(left, _mm512_setzero_si512()) | ~far | ends);
+		return moved | static_cast<uint32_t>(done) << L;
+	}
+
+	__attribute__((target("avx2,fma"))) static inline __m256i mulLoAVX2(__m256i a, __m256i b){ // a * b mod 2^64
+		__m256i cross = _mm256_add_epi64(_mm256_mul_epu32(a, _mm256_srli_epi64(b, 32)), _mm256_mul_epu32(_mm256_srli_epi64(a, 32), b));
+		return _mm256_add_epi64(_mm256_mul_epu32(a, b), _mm256_slli_epi64(cross, 32));
+	}
+
+	__attribute__((target("avx2,fma"))) static inline __m256d toUniAVX2(__m256i c){
+		const __m256i lo32 = _mm256_set1_epi64x(0xFFFFFFFF);
+		const __m256d two52 = _mm256_set1_pd(4503599627370496.0);
+		// q = c / 10^15 estimated from the high half alone (hi * 2^32 / 10^15), which is off by at most one
+		__m256d hd = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(_mm256_srli_epi64(c, 32), _mm256_castpd_si256(two52))), two52);
+		__m256d qd = _mm256_floor_pd(_mm256_mul_pd(hd, _mm256_set1_pd(4294967296.0 / 1e15)));
+		__m256i q = _mm256_and_si256(_mm256_castpd_si256(_mm256_add_pd(qd, two52)), lo32);
+		const __m256i mod = _mm256_set1_epi64x(1000000000000000LL);
+		__m256i r = _mm256_sub_epi64(c, mulLoAVX2(q, mod));
+		r = _mm256_add_epi64(r, _mm256_and_si256(_mm256_cmpgt_epi64(_mm256_setzero_si256(), r), mod));
+		r = _mm256_sub_epi64(r, _mm256_and_si256(_mm256_cmpgt_epi64(r, _mm256_set1_epi64x(999999999999999LL)), mod));
+
+		__m256d rd = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(r, _mm256_castpd_si256(two52))), two52);
+		const __m256d e5 = _mm256_set1_pd(100000.0);
+		const __m256d one = _mm256_set1_pd(1.0);
+		__m256d mid = _mm256_floor_pd(_mm256_mul_pd(rd, _mm256_set1_pd(1e-5)));
+		mid = _mm256_sub_pd(mid, _mm256_and_pd(_mm256_cmp_pd(_mm256_mul_pd(mid, e5), rd, _CMP_GT_OQ), one));
+		mid = _mm256_add_pd(mid, _mm256_and_pd(_mm256_cmp_pd(_mm256_mul_pd(_mm256_add_pd(mid, one), e5), rd, _CMP_LE_OQ), one));
+		__m256d u = _mm256_mul_pd(mid, _mm256_set1_pd(1e-10));
+		return _mm256_fmadd_pd(_mm256_fnmadd_pd(u, _mm256_set1_pd(10000000000.0), mid), _mm256_set1_pd(1e-10), u);
+	}
+
+	__attribute__((target("avx2,fma"))) static inline __m256i stepAVX2(__m256i curr, __m256i weyl){ // square, add the Weyl counter, swap halves
+		return _mm256_shuffle_epi32(_mm256_add_epi64(mulLoAVX2(curr, curr), weyl), 0xB1);
+	}
+
+	// boundAVX512() on 4 lanes, with the lanes as all-ones vector masks
+	__attribute__((target("avx2,fma"))) static inline __m256d boundAVX2(RejectBoundary, __m256d&, __m256d, __m256d, __m256d) {return _mm256_setzero_pd();} // not called
+
+	__attribute__((target("avx2,fma"))) static inline __m256d boundAVX2(ReflectBoundary, __m256d& c, __m256d lo, __m256d hi, __m256d m){
+		alignas(32) double raw[4], r[4], l[4], h[4];
+		_mm256_store_pd(raw, c);
+		c = _mm256_blendv_pd(c, _mm256_min_pd(_mm256_sub_pd(_mm256_add_pd(hi, hi), c), c), m);
+		c = _mm256_blendv_pd(c, _mm256_max_pd(_mm256_sub_pd(_mm256_add_pd(lo, lo), c), c), m);
+		int rest = _mm256_movemask_pd(_mm256_and_pd(_mm256_cmp_pd(c, hi, _CMP_GT_OQ), m));
+		if (rest){
+			_mm256_store_pd(r, c);
+			_mm256_store_pd(l, lo);
+			_mm256_store_pd(h, hi);
+			boundRest<ReflectBoundary>(r, raw, l, h, rest);
+			c = _mm256_load_pd(r);
+		}
+		return _mm256_setzero_pd();
+	}
+
+	__attribute__((target("avx2,fma"))) static inline __m256d boundAVX2(PeriodicBoundary, __m256d& c, __m256d lo, __m256d hi, __m256d m){
+		alignas(32) double raw[4], r[4], l[4], h[4];
+		_mm256_store_pd(raw, c);
+		__m256d w = _mm256_sub_pd(hi, lo);
+		__m256d below = _mm256_and_pd(_mm256_cmp_pd(c, lo, _CMP_LT_OQ), m), above = _mm256_and_pd(_mm256_cmp_pd(c, hi, _CMP_GT_OQ), m);
+		c = _mm256_blendv_pd(c, _mm256_sub_pd(c, w), above);
+		c = _mm256_blendv_pd(c, _mm256_add_pd(c, w), below);
+		__m256d out = _mm256_or_pd(_mm256_cmp_pd(c, lo, _CMP_LT_OQ), _mm256_cmp_pd(c, hi, _CMP_GT_OQ));
+		int rest = _mm256_movemask_pd(_mm256_and_pd(out, m));
+		if (rest){
+			_mm256_store_pd(r, c);
+			_mm256_store_pd(l, lo);
+			_mm256_store_pd(h, hi);
+			boundRest<PeriodicBoundary>(r, raw, l, h, rest);
+			c = _mm256_load_pd(r);
+		}
+		return _mm256_setzero_pd();
+	}
+
+	__attribute__((target("avx2,fma"))) static inline __m256d boundAVX2(AbsorbBoundary, __m256d& c, __m256d lo, __m256d hi, __m256d m){
+		__m256d out = _mm256_and_pd(_mm256_or_pd(_mm256_cmp_pd(c, hi, _CMP_GT_OQ), _mm256_cmp_pd(c, lo, _CMP_LT_OQ)), m);
+		c = _mm256_blendv_pd(c, _mm256_min_pd(hi, _mm256_max_pd(lo, c)), m);
+		return out;
+	}
+
+	template<class Boundary>
+	__attribute__((target("avx2,fma"))) static uint32_t attemptAVX2(Lanes& s, uint32_t active){ // the AVX-512 kernel on lanes 0-3, then 4-7, with vector masks
+		uint32_t moved = 0;
+		for (int h = 0; h < L; h += 4){
+			const __m256i lane = _mm256_set_epi64x(8, 4, 2, 1);
+			const __m256i m = _mm256_cmpeq_epi64(_mm256_and_si256(_mm256_set1_epi64x(active >> h), lane), lane);
+			if (_mm256_testz_si256(m, m))
+				continue;
+			const __m256i key = _mm256_load_si256(reinterpret_cast<const __m256i*>(s.key + h));
+			__m256i curr = _mm256_load_si256(reinterpret_cast<const __m256i*>(s.curr + h));
+			__m256i weyl = _mm256_load_si256(reinterpret_cast<const __m256i*>(s.weyl + h));
+
+			weyl = _mm256_add_epi64(weyl, _mm256_and_si256(key, m));
+			curr = _mm256_blendv_epi8(curr, stepAVX2(curr, weyl), m);
+			__m256d d = toUniAVX2(curr);
+
+			__m256i bitBuf = _mm256_load_si256(reinterpret_cast<const __m256i*>(s.bitBuf + h));
+			__m256i bitCnt = _mm256_load_si256(reinterpret_cast<const __m256i*>(s.bitCnt + h));
+			const __m256i refill = _mm256_and_si256(m, _mm256_cmpgt_epi64(_mm256_set1_epi64x(2), bitCnt));
+			weyl = _mm256_add_epi64(weyl, _mm256_and_si256(key, refill));
+			curr = _mm256_blendv_epi8(curr, stepAVX2(curr, weyl), refill);
+			bitBuf = _mm256_or_si256(bitBuf, _mm256_and_si256(refill, _mm256_sllv_epi64(_mm256_and_si256(curr, _mm256_set1_epi64x(0xFFFFFFFF)), bitCnt)));
+			bitCnt = _mm256_add_epi64(bitCnt, _mm256_and_si256(refill, _mm256_set1_epi64x(32)));
+			const __m256i xAxis = _mm256_cmpeq_epi64(_mm256_and_si256(bitBuf, _mm256_set1_epi64x(1)), _mm256_set1_epi64x(1));
+			const __m256i up = _mm256_cmpeq_epi64(_mm256_and_si256(bitBuf, _mm256_set1_epi64x(2)), _mm256_set1_epi64x(2));
+			bitBuf = _mm256_blendv_epi8(bitBuf, _mm256_srli_epi64(bitBuf, 2), m);
+			bitCnt = _mm256_sub_epi64(bitCnt, _mm256_and_si256(m, _mm256_set1_epi64x(2)));
+			_mm256_store_si256(reinterpret_cast<__m256i*>(s.curr + h), curr);
+			_mm256_store_si256(reinterpret_cast<__m256i*>(s.weyl + h), weyl);
+			_mm256_store_si256(reinterpret_cast<__m256i*>(s.bitBuf + h), bitBuf);
+			_mm256_store_si256(reinterpret_cast<__m256i*>(s.bitCnt + h), bitCnt);
+
+			__m256d step = _mm256_xor_pd(d, _mm256_andnot_pd(_mm256_castsi256_pd(up), _mm256_set1_pd(-0.0)));
+			__m256d x = _mm256_load_pd(s.x + h), y = _mm256_load_pd(s.y + h);
+			__m256d nx = _mm256_blendv_pd(x, _mm256_add_pd(x, step), _mm256_castsi256_pd(xAxis));
+			__m256d ny = _mm256_blendv_pd(_mm256_add_pd(y, step), y, _mm256_castsi256_pd(xAxis));
+
+			__m256d mv = _mm256_castsi256_pd(m), ends = _mm256_setzero_pd();
+			if (Boundary::REDRAW){
+				__m256d out = _mm256_or_pd(_mm256_or_pd(_mm256_cmp_pd(nx, _mm256_load_pd(s.maxX + h), _CMP_GT_OQ), _mm256_cmp_pd(nx, _mm256_load_pd(s.minX + h), _CMP_LT_OQ)),
+						_mm256_or_pd(_mm256_cmp_pd(ny, _mm256_load_pd(s.maxY + h), _CMP_GT_OQ), _mm256_cmp_pd(ny, _mm256_load_pd(s.minY + h), _CMP_LT_OQ)));
+				mv = _mm256_andnot_pd(out, mv);
+			}
+			else{
+				const __m256d xa = _mm256_castsi256_pd(xAxis);
+				__m256d c = _mm256_blendv_pd(ny, nx, xa);
+				__m256d lo = _mm256_blendv_pd(_mm256_load_pd(s.minY + h), _mm256_load_pd(s.minX + h), xa);
+				__m256d hi = _mm256_blendv_pd(_mm256_load_pd(s.maxY + h), _mm256_load_pd(s.maxX + h), xa);
+				ends = boundAVX2(Boundary(), c, lo, hi, mv);
+				nx = _mm256_blendv_pd(nx, c, xa);
+				ny = _mm256_blendv_pd(c, ny, xa);
+			}
+			_mm256_store_pd(s.x + h, _mm256_blendv_pd(x, nx, mv));
+			_mm256_store_pd(s.y + h, _mm256_blendv_pd(y, ny, mv));
+			__m256i left = _mm256_load_si256(reinterpret_cast<const __m256i*>(s.left + h));
+			left = _mm256_add_epi64(left, _mm256_castpd_si256(mv)); // mv lanes are -1
+			_mm256_store_si256(reinterpret_cast<__m256i*>(s.left + h), left);
+
+			const __m256d err = _mm256_set1_pd(DES_ERROR);
+			const __m256d abs = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7FFFFFFFFFFFFFFFLL));
+			__m256d far = _mm256_or_pd(_mm256_cmp_pd(_mm256_and_pd(_mm256_sub_pd(nx, _mm256_load_pd(s.desX + h)), abs), err, _CMP_GE_OQ),
+					_mm256_cmp_pd(_mm256_and_pd(_mm256_sub_pd(ny, _mm256_load_pd(s.desY + h)), abs), err, _CMP_GE_OQ));
+			__m256d done = _mm256_and_pd(mv, _mm256_or_pd(_mm256_or_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(left, _mm256_setzero_si256())), _mm256_xor_pd(far, _mm256_castsi256_pd(_mm256_set1_epi64x(-1)))), ends));
+			moved |= static_cast<uint32_t>(_mm256_movemask_pd(mv)) << h;
+			moved |= static_cast<uint32_t>(_mm256_movemask_pd(done)) << (h + L);
+		}
+		return moved;
+	}
+#endif
+
+	template<class Boundary>
+	static Kernel kernel(){ // the widest kernel this CPU runs, picked once per boundary
+		static const Kernel k = pickKernel<Boundary>();
+		return k;
+	}
+
+	template<class Boundary>
+	static Kernel pickKernel(){
+#if defined(WALK_LANES_DISPATCH)
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq"))
+			return attemptAVX512<Boundary>;
+		if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+			return attemptAVX2<Boundary>;
+#endif
+		return attemptScalar<Boundary>;
+	}
+
+	template<class Step, class Boundary>
+	static bool vectorizable(const BasicRandomWalk<double, Step, Boundary>& rw){ // the kernels draw each distance as UniformStep does; the sampler only matters with RejectBoundary
+		const bool uniform = std::is_same<Step, UniformStep>::value || (std::is_same<Step, DynamicStep>::value && rw.getMode() == 0); // not a policy derived from UniformStep, which may draw otherwise
+		return uniform && (rw.sampler == STEP_REJECTION || !Boundary::REDRAW) && rw.rn.getUniMode() == UNI_LEGACY && !rw.targets;
+	}
+
+	template<class Walk>
+	static void load(Lanes& s, int k, const Walk& rw, int steps){ // put a walker into lane k
+		const MiddleSquareEngine& eng = rw.rn.eng;
+		s.curr[k] = eng.curr;
+		s.weyl[k] = eng.weyl;
+		s.key[k] = eng.key;
+		s.bitBuf[k] = rw.rn.bitBuf;
+		s.bitCnt[k] = rw.rn.bitCnt;
+		s.left[k] = steps;
+		s.x[k] = rw.staX;
+		s.y[k] = rw.staY;
+		s.maxX[k] = rw.maxX; s.minX[k] = rw.minX; s.maxY[k] = rw.maxY; s.minY[k] = rw.minY;
+		s.desX[k] = rw.desX; s.desY[k] = rw.desY;
+	}
+
+	template<class Walk>
+	static void store(const Lanes& s, int k, Walk& rw){ // give the walker in lane k its generator state back
+		rw.rn.eng.curr = s.curr[k];
+		rw.rn.eng.weyl = s.weyl[k];
+		rw.rn.bitBuf = s.bitBuf[k];
+		rw.rn.bitCnt = static_cast<int>(s.bitCnt[k]);
+	}
+
+public:
+	static const char* isa(){ // name of the kernel in use: "avx512", "avx2" or "scalar"
+#if defined(WALK_LANES_DISPATCH)
+		if (kernel<RejectBoundary>() == attemptAVX512<RejectBoundary>)
+			return "avx512";
+		if (kernel<RejectBoundary>() == attemptAVX2<RejectBoundary>)
+			return "avx2";
+#endif
+		return "scalar";
+	}
+
+	/* Walk walkers[0..n) as walkers[i].walk(steps) would. If paths is given, walker i's
+	 * positions go to paths[i] as with walk(steps, paths[i]); if points is given, points[i]
+	 * is the number of positions, and endX / endY receive the last one. Each walker's
+	 * generator is left in the state walk() leaves it in. The walkers can have any step and
+	 * boundary policy.
+	 */
+	template<class Step, class Boundary>
+	static void walk(BasicRandomWalk<double, Step, Boundary>* walkers, size_t n, int steps, WalkTrajectory<double>* paths,
+			int* points = nullptr, double* endX = nullptr, double* endY = nullptr){
+		Lanes s;
+		int lane[L]; // walker index of each lane
+		double* px[L]; // where each lane writes its next position, if paths are kept
+		double* py[L];
+		uint32_t active = 0;
+		size_t next = 0;
+		const Kernel attempt = kernel<Boundary>();
+
+		auto finish = [&](size_t i, double x, double y, int count){
+			if (paths)
+				paths[i].n = count;
+			if (points)
+				points[i] = count;
+			if (endX)
+				endX[i] = x;
+			if (endY)
+				endY[i] = y;
+		};
+
+		auto refill = [&](int k){ // give lane k the next walker that needs it, or leave it idle
+			while (next < n){
+				size_t i = next++;
+				BasicRandomWalk<double, Step, Boundary>& rw = walkers[i];
+				rw.settleStart();
+				if (!vectorizable(rw) || steps <= 0){
+					int count;
+					double x, y;
+					if (paths){
+						count = rw.walk(steps, paths[i]);
+						x = paths[i].x[count - 1];
+						y = paths[i].y[count - 1];
+					}
+					else{
+						count = 0;
+						for (const std::pair<double, double>& p : rw.lazyWalk(steps)){
+							x = p.first;
+							y = p.second;
+							count++;
+						}
+					}
+					finish(i, x, y, count);
+					continue;
+				}
+				load(s, k, rw, steps);
+				lane[k] = static_cast<int>(i);
+				if (paths){
+					paths[i].fit(steps + 1);
+					px[k] = paths[i].x.data();
+					py[k] = paths[i].y.data();
+					*px[k]++ = rw.staX;
+					*py[k]++ = rw.staY;
+				}
+				active |= 1u << k;
+				return;
+			}
+			active &= ~(1u << k);
+		};
+
+		for (int k = 0; k < L; k++)
+			refill(k);
+		while (active){
+			uint32_t res = attempt(s, active);
+			if (paths){
+				for (uint32_t m = res & ((1u << L) - 1); m; m &= m - 1){
+					int k = __builtin_ctz(m);
+					*px[k]++ = s.x[k];
+					*py[k]++ = s.y[k];
+				}
+			}
+			for (uint32_t m = res >> L; m; m &= m - 1){ // done: hand the state back and take the next walker
+				int k = __builtin_ctz(m);
+				store(s, k, walkers[lane[k]]);
+				finish(lane[k], s.x[k], s.y[k], static_cast<int>(steps - s.left[k] + 1));
+				refill(k);
+			}
+		}
+	}
+};
+
+
+
+#endif /* RANDOM_WALK_LANES_H_ */
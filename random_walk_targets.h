@@ -0,0 +1,223 @@
+/*
+ * random_walk_targets.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: fanchen
+ */
+
+#ifndef RANDOM_WALK_TARGETS_H_
+#define RANDOM_WALK_TARGETS_H_
+
+#include <cstddef> // size_t
+#include <cstdint> // uint32_t
+#include <cmath> // std::sqrt(), std::floor(), std::abs()
+#include <vector>
+#include <algorithm> // std::min(), std::max(), std::sort(), std::upper_bound()
+
+/* Destination regions of BasicRandomWalk::setDes(const DestinationSet&), closed disks and
+ * rectangles. A walker reaches them when a step touches one anywhere along the axis-aligned
+ * segment it travels, not only where it lands, and it stops at the first point it touches.
+ */
+struct DestinationRegion{
+	enum Shape {DISK, RECT};
+	Shape shape;
+	double x0, y0, x1, y1; // bounding box; a disk's center is its middle
+
+	static DestinationRegion disk(double cx, double cy, double r){
+		DestinationRegion d = {DISK, cx - r, cy - r, cx + r, cy + r};
+		return d;
+	}
+
+	static DestinationRegion rect(double xa, double ya, double xb, double yb){
+		DestinationRegion d = {RECT, std::min(xa, xb), std::min(ya, yb), std::max(xa, xb), std::max(ya, yb)};
+		return d;
+	}
+
+	/* The part [lo, hi] of the line y = o (alongX) or x = o (!alongX) inside the region; false if
+	 * the line misses it. o is tested against the bounding box, as DestinationSet does to list
+	 * the region in the strips it overlaps.
+	 */
+	bool span(bool alongX, double o, double& lo, double& hi) const{
+		double a0 = alongX ? x0 : y0, a1 = alongX ? x1 : y1; // along the line
+		double b0 = alongX ? y0 : x0, b1 = alongX ? y1 : x1; // across it
+		if (o < b0 || o > b1)
+			return false;
+		if (shape == RECT){
+			lo = a0;
+			hi = a1;
+			return true;
+		}
+		double r = 0.5 * (b1 - b0), dc = o - 0.5 * (b0 + b1), mid = 0.5 * (a0 + a1);
+		double s = std::sqrt(std::max(r * r - dc * dc, 0.0));
+		lo = mid - s;
+		hi = mid + s;
+		return true;
+	}
+
+	bool contains(double x, double y, double tol) const{ // whether (x, y) is within tol of the region
+		if (shape == RECT)
+			return x >= x0 - tol && x <= x1 + tol && y >= y0 - tol && y <= y1 + tol;
+		double dx = x - 0.5 * (x0 + x1), dy = y - 0.5 * (y0 + y1), r = 0.5 * (x1 - x0) + tol;
+		return dx * dx + dy * dy <= r * r;
+	}
+};
+
+/* An immutable set of destination regions, indexed for the axis-aligned steps of a walk by
+ * two uniform grids of strips: rows for the steps along x and columns for those along y,
+ * about one strip per region, each listing the regions that overlap it sorted by their low
+ * end along the strip. A step finds its strip by one division and the regions that can lie
+ * on its segment by one binary search, so its cost does not grow with the number of regions
+ * (a grid of square cells would make it cross more cells the more regions there are). A set
+ * can be shared by walkers on any number of threads.
+ */
+class DestinationSet{
+private:
+	struct Strips{ // strip k covers [origin + k / inv, origin + (k + 1) / inv) across the lines it holds
+		double origin, inv;
+		int count;
+		std::vector<uint32_t> start; // strip k lists ids[start[k] .. start[k + 1])
+		std::vector<uint32_t> ids;
+		std::vector<double> low; // low end along the strip of region ids[i], ascending within a strip
+		std::vector<double> reach; // longest region of strip k along it, with some slack for rounding
+
+		Strips() : origin(0), inv(1), count(0), start(1, 0){}
+
+		int strip(double v) const{ // the strip of coordinate v, clamped to the grid
+			double f = (v - origin) * inv;
+			return f < 0 ? 0 : (f >= count ? count - 1 : static_cast<int>(f)); // the cast rounds down for f >= 0
+		}
+
+		bool holds(double v) const{ // whether v is on the grid
+			double f = (v - origin) * inv;
+			return f >= 0 && f < count;
+		}
+	};
+
+	std::vector<DestinationRegion> regions;
+	Strips rows, cols;
+
+	void index(Strips& s, bool alongX, double slack){
+		size_t n = regions.size();
+		double lo = alongX ? regions[0].y0 : regions[0].x0, hi = alongX ? regions[0].y1 : regions[0].x1, across = 0;
+		for (size_t i = 0; i < n; i++){
+			const DestinationRegion& r = regions[i];
+			lo = std::min(lo, alongX ? r.y0 : r.x0);
+			hi = std::max(hi, alongX ? r.y1 : r.x1);
+			across += alongX ? r.y1 - r.y0 : r.x1 - r.x0;
+		}
+		// one strip per region, but no narrower than the regions are on average, so that a region
+		// is listed in about two strips
+		double width = std::max((hi - lo) / n, across / n);
+		if (!(width > 0))
+			width = 1;
+		s.origin = lo;
+		s.inv = 1 / width;
+		s.count = static_cast<int>(std::floor((hi - lo) * s.inv)) + 1; // + 1 keeps the high edge on the grid
+
+		std::vector<uint32_t> order(n);
+		for (size_t i = 0; i < n; i++)
+			order[i] = static_cast<uint32_t>(i);
+		std::sort(order.begin(), order.end(), [this, alongX](uint32_t a, uint32_t b){
+			return alongX ? regions[a].x0 < regions[b].x0 : regions[a].y0 < regions[b].y0;
+		});
+		s.start.assign(static_cast<size_t>(s.count) + 1, 0);
+		for (size_t i = 0; i < n; i++){
+			const DestinationRegion& r = regions[i];
+			for (int k = s.strip(alongX ? r.y0 : r.x0); k <= s.strip(alongX ? r.y1 : r.x1); k++)
+				s.start[k + 1]++;
+		}
+		for (int k = 0; k < s.count; k++)
+			s.start[k + 1] += s.start[k];
+		s.ids.resize(s.start.back());
+		s.low.resize(s.start.back());
+		s.reach.assign(s.count, 0.0);
+		std::vector<uint32_t> fill(s.start.begin(), s.start.end() - 1);
+		for (size_t i = 0; i < n; i++){ // in the order of the low ends, so every strip is sorted
+			const DestinationRegion& r = regions[order[i]];
+			double a0 = alongX ? r.x0 : r.y0, len = alongX ? r.x1 - r.x0 : r.y1 - r.y0;
+			for (int k = s.strip(alongX ? r.y0 : r.x0); k <= s.strip(alongX ? r.y1 : r.x1); k++){
+				s.ids[fill[k]] = order[i];
+				s.low[fill[k]++] = a0;
+				s.reach[k] = std::max(s.reach[k], len + slack);
+			}
+		}
+	}
+
+	bool onSegment(size_t id, bool alongX, double o, double a, double b, double& entry) const{ // where the segment from a to b first touches region id
+		double lo, hi;
+		if (!regions[id].span(alongX, o, lo, hi) || (b >= a ? (lo > b || hi < a) : (hi < b || lo > a)))
+			return false;
+		entry = b >= a ? std::max(a, lo) : std::min(a, hi);
+		return true;
+	}
+
+public:
+	DestinationSet(){}
+
+	explicit DestinationSet(const std::vector<DestinationRegion>& r) : regions(r){
+		if (regions.empty())
+			return;
+		double m = 0; // largest coordinate, for the slack that covers rounding in x0 + (x1 - x0)
+		for (size_t i = 0; i < regions.size(); i++)
+			m = std::max(m, std::max(std::max(std::abs(regions[i].x0), std::abs(regions[i].x1)), std::max(std::abs(regions[i].y0), std::abs(regions[i].y1))));
+		double slack = 1e-12 * (1 + m);
+		index(rows, true, slack);
+		index(cols, false, slack);
+	}
+
+	size_t size() const {return regions.size();}
+	const DestinationRegion& operator[](size_t i) const {return regions[i];}
+
+	/* The first point where the segment from a to b on the line y = o (alongX) or x = o
+	 * (!alongX) touches a region: return true and set at to its coordinate along the line (a
+	 * itself if a is in a region), and *which to the region, if which is given.
+	 */
+	bool sweep(bool alongX, double o, double a, double b, double& at, size_t* which = nullptr) const{
+		const Strips& s = alongX ? rows : cols;
+		if (regions.empty() || !s.holds(o))
+			return false;
+		int k = s.strip(o);
+		double lo = std::min(a, b), hi = std::max(a, b);
+		// the regions of the strip that start at most at hi, back to the first that could reach lo
+		const double* first = s.low.data() + s.start[k];
+		const double* p = std::upper_bound(first, s.low.data() + s.start[k + 1], hi);
+		bool found = false;
+		double best = b;
+		size_t bestId = 0;
+		while (p != first && *--p + s.reach[k] >= lo){
+			size_t id = s.ids[p - s.low.data()];
+			double entry;
+			if (onSegment(id, alongX, o, a, b, entry) && (!found || (b >= a ? entry < best : entry > best))){
+				found = true;
+				best = entry;
+				bestId = id;
+			}
+		}
+		if (found){
+			at = best;
+			if (which)
+				*which = bestId;
+		}
+		return found;
+	}
+
+	long find(double x, double y, double tol = 0) const{ // index of a region (x, y) is within tol of, or -1
+		if (regions.empty() || y + tol < rows.origin || !(y - tol <= rows.origin + rows.count / rows.inv))
+			return -1;
+		for (int k = rows.strip(y - tol); k <= rows.strip(y + tol); k++){
+			const double* first = rows.low.data() + rows.start[k];
+			const double* p = std::upper_bound(first, rows.low.data() + rows.start[k + 1], x + tol);
+			while (p != first && *--p + rows.reach[k] >= x - tol){
+				size_t id = rows.ids[p - rows.low.data()];
+				if (regions[id].contains(x, y, tol))
+					return static_cast<long>(id);
+			}
+		}
+		return -1;
+	}
+
+	bool contains(double x, double y, double tol = 0) const {return find(x, y, tol) >= 0;}
+};
+
+
+#endif /* RANDOM_WALK_TARGETS_H_ */